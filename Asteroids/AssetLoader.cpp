@@ -0,0 +1,75 @@
+#include "AssetLoader.h"
+
+// Queue an image file to be decoded on the thread pool
+void AssetLoader::RequestImage(int handle, std::string path) {
+	pending++;
+	jobs.push_back(pool.Submit([this, handle, path] {
+		SDL_Surface* surface = IMG_Load(path.c_str());
+		if (surface == NULL) {
+			printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), SDL_GetError());
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back({ handle, path, surface });
+	}));
+}
+
+// Queue a font to be opened on the thread pool
+void AssetLoader::RequestFont(std::string path, float size) {
+	font = pool.Submit([path, size] {
+		TTF_Font* loaded = TTF_OpenFont(path.c_str(), size);
+		if (loaded == NULL) {
+			printf("Unable to load font %s! SDL_ttf Error: %s\n", path.c_str(), SDL_GetError());
+		}
+		return loaded;
+	}).share();
+}
+
+TTF_Font* AssetLoader::GetFont() {
+	return font.valid() ? font.get() : nullptr;
+}
+
+// Create textures for up to maxUploads decoded images. Must be called on the render thread.
+int AssetLoader::DrainUploads(SDL_Renderer* renderer, std::vector<SDL_Texture*>& textures, int maxUploads) {
+	std::vector<DecodedImage> batch;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		int count = std::min((int)decoded.size(), maxUploads);
+		batch.assign(decoded.begin(), decoded.begin() + count);
+		decoded.erase(decoded.begin(), decoded.begin() + count);
+	}
+	for (auto& image : batch) {
+		pending--;
+		if (image.surface == NULL) {
+			continue;
+		}
+		SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, image.surface);
+		if (texture == NULL) {
+			printf("Unable to create texture from %s! SDL Error: %s\n", image.path.c_str(), SDL_GetError());
+		}
+		else {
+			SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+			textures[image.handle] = texture;
+		}
+		SDL_DestroySurface(image.surface);
+	}
+	return batch.size();
+}
+
+int AssetLoader::Pending() {
+	return pending;
+}
+
+void AssetLoader::Close() {
+	for (auto& job : jobs) {
+		job.wait();
+	}
+	jobs.clear();
+	for (auto& image : decoded) {
+		SDL_DestroySurface(image.surface);
+	}
+	decoded.clear();
+	if (TTF_Font* loaded = GetFont()) {
+		TTF_CloseFont(loaded);
+	}
+	font = std::shared_future<TTF_Font*>();
+}
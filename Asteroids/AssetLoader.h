@@ -0,0 +1,36 @@
+#pragma once
+#include "SDL3_ttf/SDL_ttf.h"
+#include "SDL3_image/SDL_image.h"
+#include <SDL3/SDL.h>
+#include "ThreadPool.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <future>
+
+// Asset loader: decodes images and fonts on a thread pool so that startup isn't spent loading
+// assets one after another. Decoded images wait in a queue until the render thread uploads them.
+class AssetLoader {
+public:
+	void RequestImage(int handle, std::string path);	// Decode an image for the given texture handle
+	void RequestFont(std::string path, float size);		// Open a font in the background
+	TTF_Font* GetFont();	// Get the font, waiting for it if it is still loading
+	int DrainUploads(SDL_Renderer* renderer, std::vector<SDL_Texture*>& textures, int maxUploads);
+	int Pending();		// Number of requested images that haven't been uploaded yet
+	void Close();		// Wait for outstanding work and free anything that wasn't uploaded
+
+private:
+	// Supporting struct for a decoded image waiting to be uploaded
+	struct DecodedImage {
+		int handle;
+		std::string path;
+		SDL_Surface* surface;
+	};
+
+	std::mutex mutex;
+	std::vector<DecodedImage> decoded;
+	std::vector<std::future<void>> jobs;
+	std::shared_future<TTF_Font*> font;
+	int pending = 0;
+	ThreadPool pool;
+};
@@ -0,0 +1,168 @@
+#include "AssetPack.h"
+#include "SDL3_image/SDL_image.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+AssetPack::~AssetPack() {
+	Close();
+}
+
+// Decode each source image to RGBA and write it, followed by the index, to a pack file. Images
+// that can't be loaded are left out, like the game leaves them as placeholders without a pack.
+// If the pack can't be written completely, the partial file is deleted.
+bool AssetPack::Write(std::string path, const std::vector<Source>& sources) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		printf("Unable to create asset pack %s!\n", path.c_str());
+		return false;
+	}
+	Header header = { MAGIC, VERSION, (uint32_t)sources.size(), 0 };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	auto fail = [&file, &path] {
+		file.close();
+		std::remove(path.c_str());
+		return false;
+	};
+
+	std::vector<Entry> index;
+	const char padding[ALIGNMENT] = {};
+	for (auto& source : sources) {
+		SDL_Surface* loaded = IMG_Load(source.path.c_str());
+		if (loaded == NULL) {
+			printf("Skipping image %s! SDL_image Error: %s\n", source.path.c_str(), SDL_GetError());
+			continue;
+		}
+		SDL_Surface* rgba = SDL_ConvertSurface(loaded, SDL_PIXELFORMAT_RGBA32);
+		SDL_DestroySurface(loaded);
+		if (rgba == NULL) {
+			printf("Unable to convert image %s! SDL Error: %s\n", source.path.c_str(), SDL_GetError());
+			return fail();
+		}
+
+		// Align the start of the pixel data so it can be uploaded straight from the mapping
+		size_t position = file.tellp();
+		file.write(padding, (ALIGNMENT - position % ALIGNMENT) % ALIGNMENT);
+
+		Entry entry = {};
+		memcpy(entry.name, source.name.c_str(), std::min(source.name.size(), sizeof(entry.name) - 1));
+		entry.offset = (uint32_t)file.tellp();
+		entry.width = rgba->w;
+		entry.height = rgba->h;
+		entry.pitch = rgba->w * 4;
+		entry.clip = source.clip;
+		for (int y = 0; y < rgba->h; y++) {
+			file.write(static_cast<const char*>(rgba->pixels) + y * rgba->pitch, entry.pitch);
+		}
+		index.push_back(entry);
+		SDL_DestroySurface(rgba);
+	}
+
+	header.entryCount = (uint32_t)index.size();
+	header.indexOffset = (uint32_t)file.tellp();
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Entry));
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.close();
+	if (!file) {
+		printf("Unable to write asset pack %s!\n", path.c_str());
+		return fail();
+	}
+	return true;
+}
+
+// Map the pack into memory and check that its header and index are intact
+bool AssetPack::Open(std::string path) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	HANDLE view = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (view == NULL) {
+		return false;
+	}
+	data = static_cast<const uint8_t*>(MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0));
+	mapping = view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat info;
+	fstat(file, &info);
+	size = info.st_size;
+	void* view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	data = view == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(view);
+#endif
+	if (data == nullptr || size < sizeof(Header)) {
+		Close();
+		return false;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(data);
+	if (header->magic != MAGIC || header->version != VERSION ||
+		header->indexOffset + (size_t)header->entryCount * sizeof(Entry) > size) {
+		printf("Asset pack %s is invalid or out of date!\n", path.c_str());
+		Close();
+		return false;
+	}
+	for (int i = 0; i < Count(); i++) {
+		const Entry& entry = GetEntry(i);
+		if (entry.offset + (size_t)entry.pitch * entry.height > size) {
+			printf("Asset pack %s is truncated!\n", path.c_str());
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void AssetPack::Close() {
+#ifdef _WIN32
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+#else
+	if (data) {
+		munmap(const_cast<uint8_t*>(data), size);
+	}
+#endif
+	data = nullptr;
+	mapping = nullptr;
+	size = 0;
+}
+
+int AssetPack::Count() {
+	return data ? reinterpret_cast<const Header*>(data)->entryCount : 0;
+}
+
+const AssetPack::Entry& AssetPack::GetEntry(int i) {
+	const Header* header = reinterpret_cast<const Header*>(data);
+	return reinterpret_cast<const Entry*>(data + header->indexOffset)[i];
+}
+
+const void* AssetPack::GetPixels(int i) {
+	return data + GetEntry(i).offset;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Asset pack: a single file of sprites that have already been decoded to raw RGBA, followed
+// by an index of their names. The file is memory-mapped at startup and textures are created
+// straight from the mapped pixels, so no images are opened or decompressed at launch. The
+// order of the index is the order of the texture handles.
+class AssetPack {
+public:
+	static const uint32_t MAGIC = 0x4B505341;	// "ASPK"
+	static const uint32_t VERSION = 1;
+	static const uint32_t ALIGNMENT = 64;	// Alignment of each sprite's pixel data in the file
+
+	// Supporting struct for the pack header at the start of the file
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t indexOffset;
+	};
+
+	// Supporting struct for one sprite in the index
+	struct Entry {
+		char name[48];
+		uint32_t offset;	// Offset of the pixel data from the start of the file
+		uint32_t width;
+		uint32_t height;
+		uint32_t pitch;
+		SDL_Rect clip;
+	};
+
+	// Supporting struct for a sprite to be baked into a pack
+	struct Source {
+		std::string name;
+		std::string path;
+		SDL_Rect clip;
+	};
+
+	~AssetPack();
+
+	static bool Write(std::string path, const std::vector<Source>& sources);	// Bake images into a pack
+	bool Open(std::string path);	// Map a pack into memory
+	void Close();
+
+	int Count();
+	const Entry& GetEntry(int i);
+	const void* GetPixels(int i);
+
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	void* mapping = nullptr;	// Platform handle that keeps the mapping alive
+};
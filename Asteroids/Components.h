@@ -1,34 +1,32 @@
 #pragma once
 #include "Vector2.h"
+#include "TimerWheel.h"
 #include <string>
-#include <SDL3/SDL_render.h>
 
 // Transform: component for storing the positional data of an object.
 struct Transform {
 	Vector2 position = { 0,0 };
-	Vector2 velocity = { 0,0 };
+	Vector2 previous = { 0,0 };	// Position before the last physics step, for swept collision tests
+	Vector2 velocity = { 0,0 };	// Pixels per 60 Hz frame
 	float angularVelocity = 0;
 	float rotation = 0;
 };
 
-// SpriteRenderer: component for storing the name of a visible object's sprite.
+// Render layers for sprites, drawn from lowest to highest.
+enum RenderLayer { LAYER_BULLETS, LAYER_ASTEROIDS, LAYER_SHIPS, LAYER_EFFECTS };
+
+// SpriteRenderer: component for storing the name of a visible object's sprite and the layer it is drawn on.
 struct SpriteRenderer {
 	std::string sprite = "";
+	int layer = LAYER_BULLETS;
 };
 
 // TextRenderer: component for storing a text message to be displayed.
 struct TextRenderer {
 	std::string message = "";
-	std::string currentMessage = "";
-	SDL_Texture* texture = nullptr;
 	bool visible = true;
 };
 
-// DestroyTimer: component for storing the countdown timer for an object's destruction.
-struct DestroyTimer {
-	int countdown = 20;
-};
-
 // Asteroid: component for storing the size of an asteroid.
 struct Asteroid {
 	int size = 0;
@@ -39,13 +37,23 @@ struct Score {
 	int score = 0;
 };
 
-// InstructionsTimer: component for storing the duration of instructions.
-struct InstructionsTimer {
-	int timer = 0;
+// Ship: component for storing the timer that is pending while the ship reloads.
+struct Ship {
+	TimerHandle reload;
+	bool invulnerable = false;
 };
 
-// Ship: component for storing the reload countdown timer and the state of the spacebar.
-struct Ship {
-	int reloadTimer = 0;
-	bool spaceHeld = false;
+// Dormant: component for an asteroid far from the screen, which isn't moved frame by frame. Its
+// position is worked out from where it fell asleep when needed, and a timer wakes it up once its
+// path comes back near the screen.
+struct Dormant {
+	Vector2 origin;	// Where the asteroid was when it fell asleep
+	long long frame = 0;	// The frame count at which it was at the origin
+	TimerHandle wake;
+};
+
+// AsteroidHit: event sent when a bullet hits an asteroid.
+struct AsteroidHit {
+	Vector2 position;	// Where the asteroid was hit
+	Vector2 impact;	// Where the bullet was
 };
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 #include "ECSLib.h"
 #include "Components.h"
+#include "Singletons.h"
 #include <numbers>
+#include <algorithm>
 
 class ObjectCreatorInterface : public GInterface {
 public:
@@ -9,9 +11,11 @@ public:
 	void CreateAsteroid(Vector2 position, Vector2 velocity, int size) {
 		Object asteroid = CreateObject("asteroid");
 		asteroid.GetComponent<Transform>().position = position;
+		asteroid.GetComponent<Transform>().previous = position;	// Not swept in from the origin on its first frame
 		asteroid.GetComponent<Transform>().velocity = velocity;
-		asteroid.GetComponent<Transform>().rotation = rand() % 360;
+		asteroid.GetComponent<Transform>().rotation = GetSingleton<RandomGenerator>().random.Int(360);
 		asteroid.GetComponent<SpriteRenderer>().sprite = size == 2 ? "big" : size == 1 ? "med" : "small";
+		asteroid.GetComponent<SpriteRenderer>().layer = LAYER_ASTEROIDS;
 		asteroid.GetComponent<Asteroid>().size = size;
 		AddTag(asteroid, "asteroid");
 	}
@@ -19,17 +23,43 @@ public:
 	void CreateBullet(Vector2 position, Vector2 velocity, float angle) {
 		Object bullet = CreateObject("bullet");
 		bullet.GetComponent<Transform>().position = position;
+		bullet.GetComponent<Transform>().previous = position;
 		bullet.GetComponent<Transform>().velocity = Vector2::Unit((angle - 90) * std::numbers::pi / 180) * 40 + velocity;
 		bullet.GetComponent<SpriteRenderer>().sprite = "bullet";
 		bullet.GetComponent<Transform>().rotation = angle - 90;
 		AddTag(bullet, "bullet");
 	}
-	// Create an instructions object given its position, message content, and duration
-	void CreateInstructions(Vector2 position, std::string message, int timer) {
+	// Show a flashing message at the given position for the given number of frames. The task
+	// only wakes when the text flips between visible and hidden.
+	Task ShowInstructions(Vector2 position, std::string message, int frames) {
 		Object i = CreateObject("instructions");
 		i.GetComponent<Transform>().position = position;
 		i.GetComponent<TextRenderer>().message = message;
-		i.GetComponent<InstructionsTimer>().timer = timer;
 		AddTag(i, "instructions");
+		ObjectHandle handle = Handle(i);
+		while (frames > 0) {
+			// Hidden for the last 11 frames of every 50
+			int phase = frames % 50;
+			bool visible = phase > 10;
+			int run = std::min(frames, visible ? phase - 10 : phase + 1);
+			i.GetComponent<TextRenderer>().visible = visible;
+			co_await Frames(run);
+			frames -= run;
+			// A rewind can take the message away while the task waits
+			if (!Resolve(handle)) {
+				co_return;
+			}
+		}
+		DestroyObject(i);
+	}
+	// Show the controls one after another at the start of the game
+	Task ShowIntro() {
+		co_await ShowInstructions({ 1920 / 2 - 525, 1080 / 2 }, "Press UP, DOWN, LEFT, RIGHT to fly.", 300);
+		co_await ShowInstructions({ 1920 / 2 - 350, 1080 / 2 }, "Press SPACE to shoot.", 300);
+	}
+	// Show the game over message and then exit the game
+	Task ShowGameOver() {
+		co_await ShowInstructions({ 1920 / 2 - 160, 1080 / 2 }, "GAME OVER", 500);
+		QuitGame();
 	}
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "Particles.h"
+#include <cmath>
+#include <numbers>
+#include <algorithm>
+
+ParticlePool::ParticlePool(int _capacity) {
+	capacity = _capacity;
+	for (auto field : { &x, &y, &vx, &vy, &drag, &size, &rotation, &spin }) {
+		field->resize(capacity);
+	}
+	age.resize(capacity);
+	life.resize(capacity);
+}
+
+int ParticlePool::Burst(const Emitter& emitter, float px, float py) {
+	int spawned = std::min(emitter.count, capacity - count);
+	// Draw each random field for the whole burst at once, straight into its array. The velocity
+	// arrays hold the angle and speed until they are turned into components.
+	random.Ranges({ vx.data() + count, (size_t)spawned }, 0, 2 * std::numbers::pi_v<float>);
+	random.Ranges({ vy.data() + count, (size_t)spawned }, emitter.minSpeed, emitter.maxSpeed);
+	random.Ranges({ size.data() + count, (size_t)spawned }, emitter.minSize, emitter.maxSize);
+	random.Ranges({ rotation.data() + count, (size_t)spawned }, 0, 360);
+	random.Ranges({ spin.data() + count, (size_t)spawned }, -emitter.maxSpin, emitter.maxSpin);
+	random.Ints({ life.data() + count, (size_t)spawned }, emitter.maxLife - emitter.minLife + 1);
+	for (int i = count; i < count + spawned; i++) {
+		float angle = vx[i];
+		float speed = vy[i];
+		x[i] = px;
+		y[i] = py;
+		vx[i] = std::cos(angle) * speed;
+		vy[i] = std::sin(angle) * speed;
+		drag[i] = emitter.drag;
+		age[i] = 0;
+		life[i] += emitter.minLife;
+	}
+	count += spawned;
+	return spawned;
+}
+
+void ParticlePool::Update(float step) {
+	// Integrate each field in its own loop so the compiler can vectorize them
+	for (int i = 0; i < count; i++) {
+		x[i] += vx[i] * step;
+		y[i] += vy[i] * step;
+	}
+	if (step == 1) {
+		for (int i = 0; i < count; i++) {
+			vx[i] *= drag[i];
+			vy[i] *= drag[i];
+		}
+	}
+	else {
+		// Drag is the fraction kept per 60 Hz frame
+		for (int i = 0; i < count; i++) {
+			float kept = std::pow(drag[i], step);
+			vx[i] *= kept;
+			vy[i] *= kept;
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		rotation[i] += spin[i] * step;
+	}
+	for (int i = 0; i < count; i++) {
+		age[i] += step;
+	}
+
+	// Expire particles by moving the last live particle into their place
+	for (int i = 0; i < count;) {
+		if (age[i] < life[i]) {
+			i++;
+			continue;
+		}
+		count--;
+		for (auto field : { &x, &y, &vx, &vy, &drag, &size, &rotation, &spin }) {
+			(*field)[i] = (*field)[count];
+		}
+		age[i] = age[count];
+		life[i] = life[count];
+	}
+}
+
+void ParticlePool::Build(ParticleBatch& batch) {
+	const float corners[4][2] = { { 0,0 }, { 1,0 }, { 1,1 }, { 0,1 } };
+	const int quad[6] = { 0,1,2,0,2,3 };
+	for (int i = 0; i < count; i++) {
+		float angle = rotation[i] * std::numbers::pi_v<float> / 180;
+		float c = std::cos(angle);
+		float s = std::sin(angle);
+		float alpha = 1 - age[i] / (float)life[i];
+		int base = batch.vertices.size();
+		for (auto& corner : corners) {
+			float cx = (corner[0] - 0.5f) * size[i];
+			float cy = (corner[1] - 0.5f) * size[i];
+			SDL_Vertex vertex;
+			vertex.position = { x[i] + cx * c - cy * s, y[i] + cx * s + cy * c };
+			vertex.color = { 1,1,1,alpha };
+			vertex.tex_coord = { corner[0], corner[1] };
+			batch.vertices.push_back(vertex);
+		}
+		for (int index : quad) {
+			batch.indices.push_back(base + index);
+		}
+	}
+}
+
+int ParticlePool::Size() {
+	return count;
+}
+
+int ParticlePool::Capacity() {
+	return capacity;
+}
+
+void ParticlePool::SetRandom(Random _random) {
+	random = _random;
+}
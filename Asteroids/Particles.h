@@ -0,0 +1,43 @@
+#pragma once
+#include "RenderQueue.h"
+#include "Random.h"
+#include <vector>
+
+// Describes a burst of particles. Each particle gets a random speed, direction, size, and
+// lifetime (in 60 Hz frames) within the given ranges.
+struct Emitter {
+	int count;
+	float minSpeed, maxSpeed;
+	float minSize, maxSize;
+	int minLife, maxLife;
+	float maxSpin;	// Degrees per frame, in either direction
+	float drag;	// Fraction of velocity kept each frame
+};
+
+// Particle pool: a fixed number of short-lived particles stored as separate arrays for each
+// field, so that updating them is a few tight loops over contiguous memory. Particles aren't
+// objects, so spawning and expiring them never touches the component arrays or groups.
+class ParticlePool {
+public:
+	ParticlePool(int _capacity);
+
+	// Spawn a burst at the given position, returning how many particles fit in the pool
+	int Burst(const Emitter& emitter, float px, float py);
+	// Move every particle by the given number of 60 Hz frames and remove the ones whose lifetime is over
+	void Update(float step = 1);
+	// Add a quad for every particle to the batch, fading each one out over its lifetime
+	void Build(ParticleBatch& batch);
+
+	int Size();
+	int Capacity();
+	// Draw the particles' random values from the given generator, e.g. a stream of the scene's
+	void SetRandom(Random _random);
+
+private:
+	int capacity;
+	int count = 0;
+	std::vector<float> x, y, vx, vy, drag, size, rotation, spin;
+	std::vector<float> age;	// Frames lived, which can be fractional at other tick rates than 60 Hz
+	std::vector<int> life;
+	Random random;
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <algorithm>
+
+// Random number generator owned by a scene, so that scenes simulated side by side don't share
+// rand()'s hidden state and the numbers drawn depend only on the scene's own seed.
+// It is counter-based (Philox4x32-10): each block of four numbers is a pure function of the seed,
+// the stream, and the block's index, so independent streams can be split off for separate
+// systems or threads without sharing any state, and bulk fills compute many blocks at once.
+class Random {
+public:
+	Random(uint64_t seed = 1, uint64_t _stream = 0) : key(seed), stream(_stream) {}
+
+	// Restart the generator's stream with the given seed
+	void Seed(uint64_t seed) {
+		key = seed;
+		index = 0;
+		used = 4;
+	}
+	// A generator for another stream of the same seed. Streams never overlap, and drawing from
+	// one doesn't change the others, so the numbers stay the same however the work is split.
+	Random Stream(uint64_t id) const {
+		return Random(key, id);
+	}
+
+	uint32_t Next() {
+		if (used == 4) {
+			Block(index++, block);
+			used = 0;
+		}
+		return block[used++];
+	}
+	// Random integer from 0 up to but not including n
+	int Int(int n) {
+		return (int)(((uint64_t)Next() * (uint32_t)n) >> 32);
+	}
+	// Random float between min and max
+	float Range(float min, float max) {
+		return min + (max - min) * ToUnit(Next());
+	}
+
+	// Fill the span with the same numbers as calling Next once for each element
+	void Fill(std::span<uint32_t> out) {
+		size_t i = 0;
+		for (; i < out.size() && used < 4; i++) {
+			out[i] = block[used++];
+		}
+		// Compute whole blocks a batch at a time, with each step of the rounds in its own loop
+		// over the batch so that the compiler can vectorize it
+		for (; out.size() - i >= 4 * LANES; i += 4 * LANES) {
+			uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+			for (int l = 0; l < LANES; l++) {
+				uint64_t counter = index + l;
+				c0[l] = (uint32_t)counter;
+				c1[l] = (uint32_t)(counter >> 32);
+				c2[l] = (uint32_t)stream;
+				c3[l] = (uint32_t)(stream >> 32);
+			}
+			uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+			for (int round = 0; round < ROUNDS; round++) {
+				for (int l = 0; l < LANES; l++) {
+					uint64_t p0 = (uint64_t)M0 * c0[l];
+					uint64_t p1 = (uint64_t)M1 * c2[l];
+					uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1[l] ^ k0;
+					uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3[l] ^ k1;
+					c1[l] = (uint32_t)p1;
+					c3[l] = (uint32_t)p0;
+					c0[l] = n0;
+					c2[l] = n2;
+				}
+				k0 += W0;
+				k1 += W1;
+			}
+			for (int l = 0; l < LANES; l++) {
+				out[i + 4 * l] = c0[l];
+				out[i + 4 * l + 1] = c1[l];
+				out[i + 4 * l + 2] = c2[l];
+				out[i + 4 * l + 3] = c3[l];
+			}
+			index += LANES;
+		}
+		for (; i < out.size(); i++) {
+			out[i] = Next();
+		}
+	}
+	// Fill the span with random integers from 0 up to but not including n
+	void Ints(std::span<int> out, int n) {
+		Fill({ (uint32_t*)out.data(), out.size() });
+		for (int& value : out) {
+			value = (int)(((uint64_t)(uint32_t)value * (uint32_t)n) >> 32);
+		}
+	}
+	// Fill the span with random floats between min and max
+	void Ranges(std::span<float> out, float min, float max) {
+		uint32_t bits[CHUNK];
+		for (size_t i = 0; i < out.size(); i += CHUNK) {
+			size_t n = std::min(out.size() - i, (size_t)CHUNK);
+			Fill({ bits, n });
+			for (size_t j = 0; j < n; j++) {
+				out[i + j] = min + (max - min) * ToUnit(bits[j]);
+			}
+		}
+	}
+
+private:
+	static const int ROUNDS = 10;
+	static const int LANES = 8;	// Blocks computed together by Fill
+	static const int CHUNK = 256;	// Numbers converted at a time by Ranges
+	static const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+	static const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+	// The 24 high bits as a float from 0 up to but not including 1
+	static float ToUnit(uint32_t bits) {
+		return (bits >> 8) * (1.0f / (1 << 24));
+	}
+
+	void Block(uint64_t counter, uint32_t* out) const {
+		uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32);
+		uint32_t c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+		uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+		for (int round = 0; round < ROUNDS; round++) {
+			uint64_t p0 = (uint64_t)M0 * c0;
+			uint64_t p1 = (uint64_t)M1 * c2;
+			c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+			c1 = (uint32_t)p1;
+			c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+			c3 = (uint32_t)p0;
+			k0 += W0;
+			k1 += W1;
+		}
+		out[0] = c0;
+		out[1] = c1;
+		out[2] = c2;
+		out[3] = c3;
+	}
+
+	uint64_t key;
+	uint64_t stream;
+	uint64_t index = 0;	// The next block to compute
+	uint32_t block[4] = {};
+	int used = 4;	// Numbers of the current block already drawn
+};
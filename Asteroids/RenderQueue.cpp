@@ -0,0 +1,125 @@
+#include "RenderQueue.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <numbers>
+
+// Build the sort key: 8 bits of layer, 24 bits of texture handle, and 32 bits of depth
+uint64_t RenderQueue::MakeKey(int layer, int texture, float depth) {
+	// Flip the float's bits so that its unsigned ordering matches its numeric ordering
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	bits = (bits & 0x80000000) ? ~bits : bits | 0x80000000;
+	return ((uint64_t)(layer & 0xFF) << 56) | ((uint64_t)(texture & 0xFFFFFF) << 32) | bits;
+}
+
+void RenderQueue::Push(int layer, int texture, float depth, SDL_FRect src, SDL_FRect dst, float rotation) {
+	commands.push_back({ MakeKey(layer, texture, depth), texture, src, dst, rotation });
+}
+
+// Stable least-significant-digit radix sort on the keys, one byte per pass. Passes where every
+// key has the same byte are skipped, which is common for the layer and texture bytes.
+void RenderQueue::Sort() {
+	sorted.resize(commands.size());
+	for (int shift = 0; shift < 64; shift += 8) {
+		size_t counts[257] = {};
+		for (auto& command : commands) {
+			counts[((command.key >> shift) & 0xFF) + 1]++;
+		}
+		if (std::find(counts + 1, counts + 257, commands.size()) != counts + 257) {
+			continue;
+		}
+		for (int i = 1; i < 257; i++) {
+			counts[i] += counts[i - 1];
+		}
+		for (auto& command : commands) {
+			sorted[counts[(command.key >> shift) & 0xFF]++] = command;
+		}
+		commands.swap(sorted);
+	}
+}
+
+// Draw the sorted commands, turning each into a rotated quad and drawing every run of quads
+// with the same texture in one call
+int RenderQueue::Flush(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures) {
+	int batches = 0;
+	size_t start = 0;
+	while (start < commands.size()) {
+		int texture = commands[start].texture;
+		size_t end = start;
+		while (end < commands.size() && commands[end].texture == texture) {
+			end++;
+		}
+
+		float width, height;
+		SDL_GetTextureSize(textures[texture], &width, &height);
+		vertices.clear();
+		indices.clear();
+		for (size_t i = start; i < end; i++) {
+			auto& command = commands[i];
+			// Rotate the corners around the center of the destination, as SDL_RenderTextureRotated does
+			float angle = command.rotation * (float)std::numbers::pi / 180;
+			float c = std::cos(angle);
+			float s = std::sin(angle);
+			float cx = command.dst.x + command.dst.w / 2;
+			float cy = command.dst.y + command.dst.h / 2;
+			const float corners[4][2] = { { 0,0 }, { 1,0 }, { 1,1 }, { 0,1 } };
+			int base = vertices.size();
+			for (auto& corner : corners) {
+				float x = (corner[0] - 0.5f) * command.dst.w;
+				float y = (corner[1] - 0.5f) * command.dst.h;
+				SDL_Vertex vertex;
+				vertex.position = { cx + x * c - y * s, cy + x * s + y * c };
+				vertex.color = { 1,1,1,1 };
+				vertex.tex_coord = { (command.src.x + corner[0] * command.src.w) / width,
+									 (command.src.y + corner[1] * command.src.h) / height };
+				vertices.push_back(vertex);
+			}
+			const int quad[6] = { 0,1,2,0,2,3 };
+			for (int index : quad) {
+				indices.push_back(base + index);
+			}
+		}
+		SDL_RenderGeometry(renderer, textures[texture], vertices.data(), vertices.size(), indices.data(), indices.size());
+		batches++;
+		start = end;
+	}
+	return batches;
+}
+
+int RenderQueue::Batches() {
+	int batches = 0;
+	for (size_t i = 0; i < commands.size(); i++) {
+		if (i == 0 || commands[i].texture != commands[i - 1].texture) {
+			batches++;
+		}
+	}
+	return batches;
+}
+
+void RenderQueue::Clear() {
+	commands.clear();
+}
+
+int RenderQueue::Size() {
+	return commands.size();
+}
+
+void ParticleBatch::Clear() {
+	vertices.clear();
+	indices.clear();
+}
+
+// Convert the texture coordinates to the texture's, in place, and draw every particle at once
+void ParticleBatch::Flush(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures) {
+	if (vertices.empty()) {
+		return;
+	}
+	float width, height;
+	SDL_GetTextureSize(textures[texture], &width, &height);
+	for (auto& vertex : vertices) {
+		vertex.tex_coord = { (clip.x + vertex.tex_coord.x * clip.w) / width,
+							 (clip.y + vertex.tex_coord.y * clip.h) / height };
+	}
+	SDL_RenderGeometry(renderer, textures[texture], vertices.data(), vertices.size(), indices.data(), indices.size());
+}
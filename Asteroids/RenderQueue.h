@@ -0,0 +1,74 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Supporting struct for a single sprite draw. The sort key orders draws by layer, then texture,
+// then depth.
+struct RenderCommand {
+	uint64_t key;
+	int texture;
+	SDL_FRect src;
+	SDL_FRect dst;
+	float rotation;
+};
+
+// Render queue: collects the sprite draws for a frame, sorts them once with a radix sort, and
+// draws each run of commands that share a texture with a single geometry call.
+class RenderQueue {
+public:
+	void Push(int layer, int texture, float depth, SDL_FRect src, SDL_FRect dst, float rotation);
+	void Sort();
+	int Flush(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures);	// Returns the number of batches drawn
+	void Clear();
+	int Size();
+	int Batches();	// Number of texture runs in the sorted queue
+
+	static uint64_t MakeKey(int layer, int texture, float depth);
+
+private:
+	std::vector<RenderCommand> commands;
+	std::vector<RenderCommand> sorted;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+};
+
+// Supporting struct for a line of text to draw at a position on the screen.
+struct TextCommand {
+	std::string message;
+	float x;
+	float y;
+};
+
+// Supporting struct for particles that share a sprite, drawn with a single call. Texture
+// coordinates are given within the clip (0 to 1) and are converted to the texture's when the
+// batch is flushed.
+struct ParticleBatch {
+	int texture;
+	SDL_FRect clip;
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	void Clear();
+	void Flush(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures);
+};
+
+// Supporting struct for measuring latency, following a frame from the input it applied to the
+// screen. Times are SDL_GetTicksNS values, left at 0 when they don't apply.
+struct FrameTiming {
+	long long tick = 0;	// Simulation frame that built this frame
+	Uint64 input = 0;	// Oldest input event the simulation applied in that frame
+	Uint64 applied = 0;	// When the simulation applied it
+	Uint64 published = 0;	// When the frame was handed to the main thread
+	Uint64 presented = 0;	// When SDL_RenderPresent returned for it
+};
+
+// Everything the simulation hands to the renderer for one frame. Only handles and values are
+// stored, so the renderer never reads the scene's objects.
+struct RenderFrame {
+	RenderQueue sprites;
+	std::vector<ParticleBatch> particles;
+	std::vector<TextCommand> text;
+	FrameTiming timing;
+};
@@ -1,4 +1,8 @@
 #include "Singletons.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <utility>
 
 bool SDLton::SDLInit()
 {
@@ -24,6 +28,10 @@ bool SDLton::SDLInit()
 			SDL_TEXTUREACCESS_TARGET,
 			SCREEN_WIDTH, SCREEN_HEIGHT
 		);
+		// Create a fully transparent texture to stand in for sprites that are still loading
+		placeholder = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, 1, 1);
+		Uint32 clear = 0;
+		SDL_UpdateTexture(placeholder, NULL, &clear, sizeof(clear));
 		// Try to intitialize the SDL_ttf library for text rendering
 		if (TTF_Init() == -1) {
 			fprintf(stderr, "TTF_Init Error: %s\n", SDL_GetError());
@@ -31,27 +39,25 @@ bool SDLton::SDLInit()
 			return 1;
 		}
 		else {
-			// Open the retro font asset
-			font = TTF_OpenFont("Assets/Retro.ttf", 48);
+			// Open the retro font asset in the background
+			assets.RequestFont("Assets/Retro.ttf", 48);
 		}
 	}
-	// Get a pointer to SDL's keyboard input
-	keyboard = SDL_GetKeyboardState(NULL);
 	// Set the vsync to display current state with every monitor refresh
 	SDL_SetRenderVSync(renderer, 1);
+	const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+	if (mode && mode->refresh_rate > 0) {
+		refreshInterval = 1000 / mode->refresh_rate;
+	}
 
-	// Load sprite assets used by the game
-	CreateSprite("ship", "Assets/ship-a1.png", { 0,0,48,48 });
-	CreateSprite("ship_accel", "Assets/ship-a2.png", { 0,0,48,48 });
-	CreateSprite("ship_reverse", "Assets/ship-a3.png", { 0,0,48,48 });
-	CreateSprite("ship_reloading", "Assets/ship-a4.png", { 0,0,48,48 });
-	CreateSprite("ship_accel_reloading", "Assets/ship-a5.png", { 0,0,48,48 });
-	CreateSprite("ship_reverse_reloading", "Assets/ship-a6.png", { 0,0,48,48 });
-	CreateSprite("big", "Assets/big-a.png", { 0,0,48,48 });
-	CreateSprite("med", "Assets/med-a.png", { 0,0,48,48 });
-	CreateSprite("small", "Assets/small-a.png", { 0,0,48,48 });
-	CreateSprite("bullet", "Assets/bullet-b1.png", { 0,0,16,16 });
-	CreateSprite("explosion", "Assets/explosions-a5.png", { 0,0,32,32 });
+	// Load sprite assets used by the game, preferably from the pre-decoded asset pack.
+	// Otherwise the images are decoded in parallel and uploaded by UploadTextures() as they
+	// finish, so the sprites draw as placeholders until then.
+	if (!LoadPack(PACK_PATH)) {
+		for (auto& sprite : SpriteAssets()) {
+			CreateSprite(sprite.name, sprite.path, sprite.clip);
+		}
+	}
 
 	// Return the success flag
 	return success;
@@ -60,10 +66,17 @@ bool SDLton::SDLInit()
 // Close and free all loaded memory
 void SDLton::SDLClose()
 {
+	assets.Close();
 	for (auto tex : textures) {
-		SDL_DestroyTexture(tex.second);
+		if (tex != placeholder) {
+			SDL_DestroyTexture(tex);
+		}
 	}
-	TTF_CloseFont(font);
+	SDL_DestroyTexture(placeholder);
+	for (auto& text : textCache) {
+		SDL_DestroyTexture(text.second.texture);
+	}
+	textCache.clear();
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 	window = NULL;
@@ -71,44 +84,92 @@ void SDLton::SDLClose()
 	SDL_Quit();
 }
 
-// Function to create texture from path and assign it a name
-void SDLton::CreateSprite(std::string name, std::string path, SDL_Rect clip) {
-	if (textures.find(path) == textures.end()) {
-		LoadTexture(path);
-	}
-
-	sprites[name] = Sprite{ textures[path], clip };
+// List of the sprite assets used by the game
+std::vector<AssetPack::Source> SDLton::SpriteAssets() {
+	return {
+		{ "ship", "Assets/ship-a1.png", { 0,0,48,48 } },
+		{ "ship_accel", "Assets/ship-a2.png", { 0,0,48,48 } },
+		{ "ship_reverse", "Assets/ship-a3.png", { 0,0,48,48 } },
+		{ "ship_reloading", "Assets/ship-a4.png", { 0,0,48,48 } },
+		{ "ship_accel_reloading", "Assets/ship-a5.png", { 0,0,48,48 } },
+		{ "ship_reverse_reloading", "Assets/ship-a6.png", { 0,0,48,48 } },
+		{ "big", "Assets/big-a.png", { 0,0,48,48 } },
+		{ "med", "Assets/med-a.png", { 0,0,48,48 } },
+		{ "small", "Assets/small-a.png", { 0,0,48,48 } },
+		{ "bullet", "Assets/bullet-b1.png", { 0,0,16,16 } },
+		{ "explosion", "Assets/explosions-a5.png", { 0,0,32,32 } },
+	};
 }
 
-// Helper function to load texture from path
-void SDLton::LoadTexture(std::string path) {
-	if (textures[path] == NULL) {
-		SDL_Texture* newTexture = NULL;
+// Offline step: decode the sprite assets and bake them into an asset pack
+bool SDLton::PackAssets(std::string path) {
+	return AssetPack::Write(path, SpriteAssets());
+}
 
-		SDL_Surface* loadedSurface = IMG_Load(path.c_str());
-		if (loadedSurface == NULL)
-		{
-			printf("Unable to load image %s! SDL_image Error: %s\n", path.c_str(), SDL_GetError());
+// Function to create the sprites from a memory-mapped asset pack. Each entry in the pack's
+// index becomes the texture with the same handle.
+bool SDLton::LoadPack(std::string path) {
+	if (!pack.Open(path)) {
+		return false;
+	}
+	for (int i = 0; i < pack.Count(); i++) {
+		const AssetPack::Entry& entry = pack.GetEntry(i);
+		SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, entry.width, entry.height);
+		if (texture == NULL) {
+			printf("Unable to create texture for %s! SDL Error: %s\n", entry.name, SDL_GetError());
+			texture = placeholder;
 		}
-		else
-		{
-			newTexture = SDL_CreateTextureFromSurface(renderer, loadedSurface);
-			if (newTexture == NULL)
-			{
-				printf("Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError());
-			}
-
-			SDL_DestroySurface(loadedSurface);
+		else {
+			SDL_UpdateTexture(texture, NULL, pack.GetPixels(i), entry.pitch);
+			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+			SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+		}
+		textures.push_back(texture);
+		sprites[entry.name] = Sprite{ (int)textures.size() - 1, entry.clip };
+	}
+	// Sprites whose images were missing when the pack was baked are drawn as the placeholder
+	for (auto& source : SpriteAssets()) {
+		if (sprites.find(source.name) == sprites.end()) {
+			textures.push_back(placeholder);
+			sprites[source.name] = Sprite{ (int)textures.size() - 1, source.clip };
 		}
+	}
+	// The pixels have been copied into the textures, so the mapping is no longer needed
+	pack.Close();
+	return true;
+}
+
+// Function to create texture from path and assign it a name
+void SDLton::CreateSprite(std::string name, std::string path, SDL_Rect clip) {
+	sprites[name] = Sprite{ LoadTexture(path), clip };
+}
 
-		textures[path] = newTexture;
-		SDL_SetTextureScaleMode(textures[path], SDL_SCALEMODE_NEAREST);
+// Helper function to request a texture from path, returning its handle. The texture is a
+// placeholder until the image has been decoded and uploaded.
+int SDLton::LoadTexture(std::string path) {
+	if (textureHandles.find(path) == textureHandles.end()) {
+		textureHandles[path] = textures.size();
+		textures.push_back(placeholder);
+		assets.RequestImage(textureHandles[path], path);
 	}
+	return textureHandles[path];
+}
+
+// Upload a batch of decoded images to the GPU. Must be called on the render thread.
+void SDLton::UploadTextures() {
+	if (assets.Pending() > 0) {
+		assets.DrainUploads(renderer, textures, UPLOADS_PER_FRAME);
+	}
+}
+
+// Helper function to get the current texture for a handle
+SDL_Texture* SDLton::GetTexture(int handle) {
+	return textures[handle];
 }
 
 // Function to load the given message using the retro font
 SDL_Texture* SDLton::LoadText(std::string textContent) {
-	SDL_Surface* text = TTF_RenderText_Blended(font, textContent.c_str(), textContent.size(), SDL_Color{ 255,255,255,255 });
+	SDL_Surface* text = TTF_RenderText_Blended(assets.GetFont(), textContent.c_str(), textContent.size(), SDL_Color{ 255,255,255,255 });
 	SDL_Texture* texture = NULL;
 	if (text) {
 		texture = SDL_CreateTextureFromSurface(renderer, text);
@@ -123,7 +184,125 @@ SDL_Texture* SDLton::LoadText(std::string textContent) {
 	return nullptr;
 }
 
+// Get the texture for a message, creating it the first time the message is drawn
+SDL_Texture* SDLton::GetText(const std::string& message) {
+	auto it = textCache.find(message);
+	if (it == textCache.end()) {
+		it = textCache.insert({ message, CachedText{ LoadText(message), presentedFrames } }).first;
+	}
+	it->second.lastUsed = presentedFrames;
+	return it->second.texture;
+}
+
+// Free the textures of messages that weren't drawn in the current frame
+void SDLton::EvictText() {
+	for (auto it = textCache.begin(); it != textCache.end();) {
+		if (it->second.lastUsed != presentedFrames) {
+			SDL_DestroyTexture(it->second.texture);
+			it = textCache.erase(it);
+		}
+		else {
+			it++;
+		}
+	}
+	presentedFrames++;
+}
+
 // Helper function to get a sprite by name
 Sprite SDLton::GetSprite(std::string name) {
 	return sprites[name];
 }
+
+// Wrap a coordinate into the range [lo, hi)
+static double WrapAxis(double p, double lo, double hi) {
+	double w = hi - lo;
+	return lo + std::fmod(std::fmod(p - lo, w) + w, w);
+}
+
+// Find the first stretch of time, from t on, during which a coordinate starting at p and moving
+// at v stays within [a, b] as it wraps around [lo, hi). Returns when the stretch starts and ends.
+static std::pair<double, double> NextInside(double p, double v, double lo, double hi, double a, double b, double t) {
+	const double never = std::numeric_limits<double>::infinity();
+	a = std::max(a, lo);
+	b = std::min(b, hi);
+	double w = hi - lo;
+	if (b - a >= w) {
+		return { t, never };
+	}
+	if (a > b) {
+		return { never, never };
+	}
+	if (v == 0) {
+		p = WrapAxis(p, lo, hi);
+		return p >= a && p <= b ? std::make_pair(t, never) : std::make_pair(never, never);
+	}
+	// Mirror the axis so that the coordinate moves forwards
+	if (v < 0) {
+		p = -p;
+		v = -v;
+		std::swap(a, b);
+		a = -a;
+		b = -b;
+	}
+	// The coordinate is inside while p + v * s is within [a + k * w, b + k * w] for a whole k
+	double k = std::ceil((p + v * t - b) / w);
+	return { std::max(t, (a + k * w - p) / v), (b + k * w - p) / v };
+}
+
+Vector2 World::Wrap(Vector2 position) const {
+	return { (float)WrapAxis(position.x, left, right), (float)WrapAxis(position.y, top, bottom) };
+}
+
+Vector2 World::Advance(Vector2 position, Vector2 velocity, long long frames) const {
+	return { (float)WrapAxis(position.x + (double)velocity.x * frames, left, right),
+		(float)WrapAxis(position.y + (double)velocity.y * frames, top, bottom) };
+}
+
+bool World::Active(Vector2 position, float margin) const {
+	return position.x >= activeLeft - margin && position.x <= activeRight + margin &&
+		position.y >= activeTop - margin && position.y <= activeBottom + margin;
+}
+
+std::pair<float, float> World::BulletSpan(Vector2 from, Vector2 to) const {
+	float enter = 0;
+	float exit = 1;
+	// Narrow the span down to where the path is between the bounds of each axis
+	auto clip = [&](float start, float move, float low, float high) {
+		if (move == 0) {
+			if (start < low || start > high) {
+				enter = 1;
+				exit = 0;
+			}
+			return;
+		}
+		float a = (low - start) / move;
+		float b = (high - start) / move;
+		enter = std::max(enter, std::min(a, b));
+		exit = std::min(exit, std::max(a, b));
+	};
+	clip(from.x, to.x - from.x, bulletLeft, bulletRight);
+	clip(from.y, to.y - from.y, bulletTop, bulletBottom);
+	return { enter, exit };
+}
+
+long long World::FramesUntilActive(Vector2 position, Vector2 velocity) const {
+	const double never = std::numeric_limits<double>::infinity();
+	double t = 0;
+	// Alternate between the axes, jumping to the next time each one is inside, until both are
+	for (int i = 0; i < 64; i++) {
+		auto x = NextInside(position.x, velocity.x, left, right, activeLeft, activeRight, t);
+		if (x.first == never) {
+			return -1;
+		}
+		auto y = NextInside(position.y, velocity.y, top, bottom, activeTop, activeBottom, x.first);
+		if (y.first == never) {
+			return -1;
+		}
+		if (y.first <= x.second) {
+			return std::max(1LL, (long long)y.first);
+		}
+		t = y.first;
+	}
+	// Paths that take this long to come back are woken to be checked again from where they got to
+	return std::max(1LL, (long long)t);
+}
@@ -3,15 +3,41 @@
 #include "SDL3_image/SDL_image.h"
 #include <SDL3/SDL.h>
 #include "ECSLib.h"
+#include "AssetLoader.h"
+#include "AssetPack.h"
+#include "SpatialGrid.h"
+#include "RenderQueue.h"
+#include "Particles.h"
+#include "Random.h"
+#include "Vector2.h"
 #include <unordered_map>
+#include <vector>
 #include <string>
+#include <array>
+#include <atomic>
+#include <bitset>
 
-// Supporting class for SDLton
+// Supporting class for SDLton. The texture is a handle into SDLton::textures.
 struct Sprite {
-	SDL_Texture* texture;
+	int texture;
 	SDL_Rect clip;
 };
 
+// Supporting class for SDLton's input ring. A key press or release, or a request to quit, with the
+// time SDL received it in nanoseconds.
+struct InputEvent {
+	enum Type { KEY_DOWN, KEY_UP, QUIT };
+	Type type;
+	SDL_Scancode key;
+	Uint64 timestamp;
+};
+
+// Supporting class for SDLton's text cache. lastUsed is the number of the last frame it was drawn in.
+struct CachedText {
+	SDL_Texture* texture;
+	long long lastUsed;
+};
+
 struct SDLton : Singleton {
 	bool SDLInit();	//Initialize the SDL library
 	void SDLClose();	//Close the SDL library
@@ -19,22 +45,126 @@ struct SDLton : Singleton {
 	const int SCREEN_WIDTH = 1920;
 	const int SCREEN_HEIGHT = 1080;
 
-	const bool* keyboard;
-	SDL_Window* window;
-	SDL_Renderer* renderer;
+	// Input events, pushed by the main thread as SDL delivers them and consumed by the simulation
+	static const int INPUT_CAPACITY = 1024;
+	SPSCRing<InputEvent, INPUT_CAPACITY> input;
+	std::atomic<int> droppedInput = 0;	// Events lost because the simulation fell too far behind
+	// Timings of presented frames, pushed by the main thread for the simulation to report
+	SPSCRing<FrameTiming, 256> presents;
+	double refreshInterval = 1000 / 60.0;	// Milliseconds between the display's refreshes
+	SDL_Window* window = nullptr;
+	SDL_Renderer* renderer = nullptr;	// Stays null when running headless
 	SDL_Texture* renderTexture;
 	SDL_Color bground = { 10,18,40 };
-	TTF_Font* font;
+	SDL_Texture* placeholder;	// Drawn in place of textures that are still loading
+	AssetLoader assets;
+	AssetPack pack;
+	const std::string PACK_PATH = "Assets/sprites.pack";
 
-	std::unordered_map<std::string, SDL_Texture*> textures;
+	// Maximum number of decoded images turned into textures per frame
+	const int UPLOADS_PER_FRAME = 16;
+
+	std::vector<SDL_Texture*> textures;
+	std::unordered_map<std::string, int> textureHandles;
 	std::unordered_map<std::string, Sprite> sprites;
+	TripleBuffer<RenderFrame> frames;	// Frames handed from the simulation to the main thread
+	std::unordered_map<std::string, CachedText> textCache;
+	long long presentedFrames = 0;
 
+	static std::vector<AssetPack::Source> SpriteAssets();	// The sprites used by the game
+	static bool PackAssets(std::string path);	// Bake the sprites into an asset pack
+	bool LoadPack(std::string path);
 	void CreateSprite(std::string name, std::string path, SDL_Rect clip);
-	void LoadTexture(std::string path);
+	int LoadTexture(std::string path);
+	void UploadTextures();
+	SDL_Texture* GetTexture(int handle);
 	SDL_Texture* LoadText(std::string textContent);
+	SDL_Texture* GetText(const std::string& message);
+	void EvictText();
 	Sprite GetSprite(std::string name);
 };
 
+// Singleton used to store the keyboard as the simulation sees it: which keys are held, and which
+// were pressed or released since the last frame, even if both happened within the same frame
+struct InputState : Singleton {
+	std::bitset<SDL_SCANCODE_COUNT> held;
+	std::bitset<SDL_SCANCODE_COUNT> pressed;
+	std::bitset<SDL_SCANCODE_COUNT> released;
+	Uint64 lastEvent = 0;	// Timestamp of the newest event applied
+
+	bool Held(SDL_Scancode key) {
+		return held[key];
+	}
+	bool Pressed(SDL_Scancode key) {
+		return pressed[key];
+	}
+	bool Released(SDL_Scancode key) {
+		return released[key];
+	}
+};
+
+// Singleton used to store the spatial index of visible objects used for culling, and the index of
+// asteroids near the screen used to find the ones a bullet may hit
+struct SpatialIndex : Singleton {
+	SpatialGrid grid;
+	SpatialGrid asteroids;
+};
+
+// Singleton used to store the particles of explosion effects: a flash where the asteroid was,
+// and debris flying out of it
+struct Particles : Singleton {
+	static constexpr Emitter FLASH = { 1, 0,0, 128,128, 20,20, 0, 1 };
+	static constexpr Emitter DEBRIS = { 12, 2,7, 12,28, 15,40, 8, 0.95f };
+	static const int CAPACITY = 32768;
+
+	ParticlePool explosions = ParticlePool(CAPACITY);
+};
+
+// Singleton used to store the scene's random number generator. Being a singleton, it is also
+// rewound along with the rest of the scene. Other users of random numbers take their own stream.
+struct RandomGenerator : Singleton {
+	static const uint64_t PARTICLE_STREAM = 1;
+
+	Random random;
+};
+
+// Singleton used to store the bounds asteroids wrap around at, and the active region around the
+// screen where they are moved frame by frame. Asteroids outside of it are left dormant.
+struct World : Singleton {
+	float left = -1000;
+	float top = -1000;
+	float right = 4000;
+	float bottom = 3000;
+	// Frames at 60 Hz simulated by each tick, since velocities are in pixels per 60 Hz frame
+	float step = 1;
+	// Bullets are destroyed once they leave this region, and only hit asteroids while inside it
+	float bulletLeft = -200;
+	float bulletTop = -200;
+	float bulletRight = 2100;
+	float bulletBottom = 1100;
+	// Covers everything asteroids can be drawn over, and the bullet region widened by the
+	// farthest an asteroid's center can be from a bullet it hits
+	float activeLeft = -320;
+	float activeTop = -320;
+	float activeRight = 2220;
+	float activeBottom = 1280;
+	// How far outside the active region an asteroid has to go to fall asleep, so that one woken a
+	// little early doesn't fall straight back asleep
+	float sleepMargin = 100;
+
+	// Move a position that went past an edge around to the other side
+	Vector2 Wrap(Vector2 position) const;
+	// Where a body moving at a constant velocity is after the given number of frames
+	Vector2 Advance(Vector2 position, Vector2 velocity, long long frames) const;
+	bool Active(Vector2 position, float margin = 0) const;
+	// The fractions of a tick at which a straight path enters and leaves the bullet region, with
+	// the first greater than the second if it is never inside
+	std::pair<float, float> BulletSpan(Vector2 from, Vector2 to) const;
+	// Frames until a body moving at a constant velocity first enters the active region (possibly
+	// a frame early), or -1 if it never will
+	long long FramesUntilActive(Vector2 position, Vector2 velocity) const;
+};
+
 // Singleton used to store data for asteroid generation rate (and "phases")
 struct AsteroidGeneration : Singleton {
 	int nextAsteroidCounter = 0;
@@ -0,0 +1,81 @@
+#pragma once
+#include "ECSLib.h"
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+
+// Spatial grid: stores objects in square cells by position so that the objects inside a
+// rectangle can be found without visiting every object. Objects are only moved between cells
+// when their position crosses a cell boundary.
+class SpatialGrid {
+public:
+	SpatialGrid(float _cellSize = 256) {
+		cellSize = _cellSize;
+	}
+
+	// Insert an object or update its position
+	void Update(Object o, float x, float y) {
+		long long cell = Key(Cell(x), Cell(y));
+		auto it = entries.find(o.GetID());
+		if (it != entries.end()) {
+			if (it->second.cell == cell) {
+				return;
+			}
+			Remove(o);
+		}
+		auto& objects = cells[cell];
+		entries[o.GetID()] = { cell, (int)objects.size() };
+		objects.push_back(o);
+	}
+
+	void Remove(Object o) {
+		auto it = entries.find(o.GetID());
+		if (it == entries.end()) {
+			return;
+		}
+		// Swap the last object in the cell into the removed object's place
+		auto& objects = cells[it->second.cell];
+		Object moved = objects.back();
+		objects[it->second.index] = moved;
+		entries[moved.GetID()].index = it->second.index;
+		objects.pop_back();
+		if (objects.empty()) {
+			cells.erase(it->second.cell);
+		}
+		entries.erase(it);
+	}
+
+	// Append the objects in every cell overlapping the rectangle
+	void Query(float x0, float y0, float x1, float y1, std::vector<Object>& out) {
+		for (int cx = Cell(x0); cx <= Cell(x1); cx++) {
+			for (int cy = Cell(y0); cy <= Cell(y1); cy++) {
+				auto it = cells.find(Key(cx, cy));
+				if (it != cells.end()) {
+					out.insert(out.end(), it->second.begin(), it->second.end());
+				}
+			}
+		}
+	}
+
+	int Size() {
+		return entries.size();
+	}
+
+private:
+	// Supporting struct for where an object is stored
+	struct Entry {
+		long long cell;
+		int index;
+	};
+
+	int Cell(float v) {
+		return (int)std::floor(v / cellSize);
+	}
+	long long Key(int cx, int cy) {
+		return ((long long)cx << 32) ^ (unsigned int)cy;
+	}
+
+	float cellSize;
+	std::unordered_map<long long, std::vector<Object>> cells;
+	std::unordered_map<int, Entry> entries;
+};
@@ -0,0 +1,218 @@
+#include "Stress.h"
+#include "Interfaces.h"
+#include "Singletons.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Read a whole argument as a number greater than zero, reporting the option it was given to if it isn't one
+static bool ParsePositive(const char* option, const char* text, int& value) {
+	char* end;
+	long parsed = strtol(text, &end, 10);
+	if (end == text || *end || parsed <= 0 || parsed > INT_MAX) {
+		printf("Invalid value for %s: \"%s\" (expected a whole number above 0)\n", option, text);
+		return false;
+	}
+	value = (int)parsed;
+	return true;
+}
+static bool ParsePositive(const char* option, const char* text, float& value) {
+	char* end;
+	value = strtof(text, &end);
+	if (end == text || *end || !(value > 0)) {
+		printf("Invalid value for %s: \"%s\" (expected a number above 0)\n", option, text);
+		return false;
+	}
+	return true;
+}
+
+bool StressConfig::Parse(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		bool valid = true;
+		if (arg == "--stress") {
+			enabled = true;
+		}
+		else if (arg == "--headless") {
+			headless = true;
+		}
+		else if (arg == "--targets" && hasValue) {
+			// Comma-separated list of asteroid counts
+			targets.clear();
+			std::string list = argv[++i];
+			for (size_t begin = 0; valid && begin <= list.size();) {
+				size_t comma = std::min(list.find(',', begin), list.size());
+				int target;
+				valid = ParsePositive("--targets", list.substr(begin, comma - begin).c_str(), target);
+				targets.push_back(target);
+				begin = comma + 1;
+			}
+		}
+		else if (arg == "--spawn-rate" && hasValue) {
+			valid = ParsePositive("--spawn-rate", argv[++i], spawnRate);
+		}
+		else if (arg == "--fire-rate" && hasValue) {
+			valid = ParsePositive("--fire-rate", argv[++i], fireRate);
+		}
+		else if (arg == "--frames" && hasValue) {
+			valid = ParsePositive("--frames", argv[++i], holdFrames);
+		}
+		else if (arg == "--worlds" && hasValue) {
+			valid = ParsePositive("--worlds", argv[++i], worlds);
+		}
+		else if (arg == "--seed" && hasValue) {
+			char* end;
+			const char* text = argv[++i];
+			seed = strtoul(text, &end, 10);
+			if (end == text || *end || *text == '-') {
+				printf("Invalid value for --seed: \"%s\" (expected a whole number)\n", text);
+				valid = false;
+			}
+		}
+		else if (arg == "--tick-rate" && hasValue) {
+			valid = ParsePositive("--tick-rate", argv[++i], tickRate);
+		}
+		else if (arg == "--world" && i + 2 < argc) {
+			valid = ParsePositive("--world", argv[++i], worldWidth) && ParsePositive("--world", argv[++i], worldHeight);
+		}
+		else if (arg == "--targets" || arg == "--spawn-rate" || arg == "--fire-rate" || arg == "--frames" || arg == "--worlds" ||
+			arg == "--seed" || arg == "--tick-rate" || arg == "--world") {
+			printf("Missing value for %s\n", arg.c_str());
+			return false;
+		}
+		else {
+			printf("Unknown stress option: %s\n", arg.c_str());
+			return false;
+		}
+		if (!valid) {
+			return false;
+		}
+	}
+	// Without a window, nothing would take the frames the game renders, so headless needs the stress
+	// scene. Only one world can have the window.
+	if (headless && !enabled) {
+		printf("--headless only runs with --stress\n");
+		return false;
+	}
+	if (worlds > 1 && !headless) {
+		printf("--worlds above 1 needs --headless\n");
+		return false;
+	}
+	return true;
+}
+
+// Stress Spawn System:
+// Spawns asteroids anywhere in the world, up to the spawn rate each frame, until the current
+// target is reached. Asteroids destroyed by bullets are replaced. Spawning stops for the frame
+// once the budget is spent, so ramping up to a large target doesn't stall single frames.
+void StressSpawnSystem::Update() {
+	auto& config = GetPersistentSingleton<StressConfig>();
+	auto& progress = GetSingleton<StressProgress>();
+	auto& world = GetSingleton<World>();
+	int count = ObjectsWith<Asteroid>().size();
+	int target = config.targets[std::min(progress.stage, (int)config.targets.size() - 1)];
+
+	int spawn = std::min(config.spawnRate, target - count);
+	if (spawn <= 0) {
+		return;
+	}
+
+	// Draw the random values of a batch at once
+	auto& random = GetSingleton<RandomGenerator>().random;
+	std::vector<float> x(BATCH), y(BATCH);
+	std::vector<int> velocities(2 * BATCH), sizes(BATCH);
+	for (int spawned = 0; spawned < spawn && !OverBudget(); spawned += BATCH) {
+		int n = std::min(BATCH, spawn - spawned);
+		random.Ranges({ x.data(), (size_t)n }, world.left, world.right);
+		random.Ranges({ y.data(), (size_t)n }, world.top, world.bottom);
+		random.Ints({ velocities.data(), (size_t)(2 * n) }, 50);
+		random.Ints({ sizes.data(), (size_t)n }, 3);
+		for (int i = 0; i < n; i++) {
+			Vector2 velocity = { (float)(velocities[2 * i] - 25) / 10, (float)(velocities[2 * i + 1] - 25) / 10 };
+			GetInterface<ObjectCreatorInterface>().CreateAsteroid({ x[i], y[i] }, velocity, sizes[i]);
+		}
+	}
+}
+
+// Autopilot System:
+// Spins the ship in place and fires at the configured rate. The ship can't be destroyed, but
+// it is recreated if it is missing.
+void AutopilotSystem::Update() {
+	auto& config = GetPersistentSingleton<StressConfig>();
+	if (ObjectsWith("ship").empty()) {
+		Object ship = CreateObject("ship");
+		ship.GetComponent<Transform>().position = { 1920 / 2,1080 / 2 };
+		ship.GetComponent<SpriteRenderer>().sprite = "ship";
+		ship.GetComponent<SpriteRenderer>().layer = LAYER_SHIPS;
+		ship.GetComponent<Ship>().invulnerable = true;
+		AddTag(ship, "ship");
+	}
+
+	for (auto object : ObjectsWith("ship")) {
+		auto& xform = object.GetComponent<Transform>();
+		auto& ship = object.ReadComponent<Ship>();
+		// Turn and fire at the same pace whatever the tick rate
+		float step = GetSingleton<World>().step;
+		xform.rotation += 3 * step;
+		if (!TimerPending(ship.reload)) {
+			GetInterface<ObjectCreatorInterface>().CreateBullet(xform.position, xform.velocity, xform.rotation);
+			object.GetComponent<Ship>().reload = ScheduleTimer(std::max(1L, std::lround(config.fireRate / step)));
+		}
+	}
+}
+
+// Stress Report System:
+// Once the asteroid count has been at the current target for the configured number of frames,
+// prints every profiler measurement and the live count of each component, then moves on to the
+// next target. The game quits after the last one.
+void StressReportSystem::Update() {
+	auto& config = GetPersistentSingleton<StressConfig>();
+	auto& progress = GetSingleton<StressProgress>();
+	int target = config.targets[progress.stage];
+	if ((int)ObjectsWith<Asteroid>().size() < target) {
+		progress.heldFrames = 0;
+		return;
+	}
+	if (++progress.heldFrames < config.holdFrames) {
+		return;
+	}
+
+	// With many worlds, only the totals over all of them are printed
+	if (config.worlds > 1) {
+		progress.heldFrames = 0;
+		if (++progress.stage == config.targets.size()) {
+			QuitGame();
+		}
+		return;
+	}
+
+	auto& profiler = GetProfiler();
+	printf("\n=== %d asteroids, averaged over the last %d frames ===\n", target, std::min(config.holdFrames, Profiler::WINDOW));
+	printf("%-40s %12s %12s\n", "measurement", "average", "max");
+	for (auto& name : profiler.Names()) {
+		printf("%-40s %12.3f %12.3f\n", name.c_str(), profiler.Average(name), profiler.Max(name));
+	}
+	if (!profiler.HistogramNames().empty()) {
+		printf("%-40s %12s %12s %12s\n", "histogram", "p50", "p95", "p99");
+		for (auto& name : profiler.HistogramNames()) {
+			printf("%-40s %12.3f %12.3f %12.3f\n", name.c_str(), profiler.Percentile(name, 0.5), profiler.Percentile(name, 0.95), profiler.Percentile(name, 0.99));
+		}
+	}
+	printf("%-40s %12s\n", "entities", "live");
+	for (auto& stats : MemoryReport()) {
+		if (stats.name == "objects" || stats.name.rfind("component:", 0) == 0) {
+			printf("%-40s %12d\n", stats.name.c_str(), stats.live);
+		}
+	}
+	fflush(stdout);
+
+	progress.heldFrames = 0;
+	if (++progress.stage == config.targets.size()) {
+		QuitGame();
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "ECSLib.h"
+#include "Components.h"
+#include <vector>
+
+// Singleton used to store the parameters of the stress test, read from the command line
+struct StressConfig : Singleton {
+	bool enabled = false;
+	bool headless = false;	// Run without a window, simulating as fast as possible
+	std::vector<int> targets = { 10000, 100000, 1000000 };	// Asteroid counts to ramp through
+	int spawnRate = 5000;	// Asteroids spawned per frame until the target is reached
+	int fireRate = 2;	// Frames between the autopilot's shots
+	int holdFrames = 120;	// Frames measured at each target before reporting
+	float worldWidth = 6000;
+	float worldHeight = 4000;
+	int worlds = 1;	// Headless worlds simulated side by side, each with its own scene
+	unsigned seed = 1;	// Seed of the first world's random numbers, the others count up from it
+	int tickRate = 60;	// Simulation ticks per second, with movement scaled to match
+
+	// Read "--stress" and its options, returning false if an option is invalid
+	bool Parse(int argc, char** argv);
+};
+
+// Singleton used to store the progress of the stress test
+struct StressProgress : Singleton {
+	int stage = 0;	// Index of the current target
+	int heldFrames = 0;	// Frames run since the target was reached
+};
+
+// Stress spawn system: keeps the asteroid count at the current target, within a time budget per frame.
+class StressSpawnSystem : public System {
+public:
+	static constexpr double BUDGET = 4;	// Milliseconds spent spawning per frame
+	static const int BATCH = 256;	// Asteroids spawned between checks of the budget
+
+	StressSpawnSystem() {
+		SetBudget(BUDGET);
+	}
+	void Update() override;
+};
+
+// Autopilot system: turns and fires the ship continuously, respawning it if needed.
+class AutopilotSystem : public System {
+public:
+	void Update() override;
+};
+
+// Stress report system: prints the timings and entity counts at each target, then moves to the next.
+class StressReportSystem : public System {
+public:
+	void Update() override;
+};
@@ -2,18 +2,97 @@
 #include "SDL3/SDL.h"
 #include "Singletons.h"
 #include "Interfaces.h"
+#include <unordered_set>
 
 // Event System: 
-// Used for polling and handling events from SDL library.
+// Drains the input ring into the InputState singleton at the start of the frame. Every press and
+// release is applied in order, so a key tapped between two frames still shows up as pressed.
 void EventSystem::Update() {
     auto& sdl = GetPersistentSingleton<SDLton>();
+    auto& input = GetSingleton<InputState>();
+    input.pressed.reset();
+    input.released.reset();
+
+    InputEvent event;
+    int events = 0;
+    Uint64 oldest = 0;
+    while (sdl.input.Pop(event)) {
+        if (event.type == InputEvent::KEY_DOWN) {
+            input.held[event.key] = true;
+            input.pressed[event.key] = true;
+        }
+        else if (event.type == InputEvent::KEY_UP) {
+            input.held[event.key] = false;
+            input.released[event.key] = true;
+        }
+        else {
+            QuitGame();
+        }
+        if (events++ == 0) {
+            oldest = event.timestamp;
+        }
+        input.lastEvent = event.timestamp;
+    }
+
+    // Note when the oldest event was applied, so the frame built now can measure its latency
+    auto& timing = sdl.frames.Back().timing;
+    timing.input = oldest;
+    timing.applied = events > 0 ? SDL_GetTicksNS() : 0;
+    GetProfiler().Count("input.events", events);
+    // Events the main thread couldn't fit in the ring since the last frame
+    GetProfiler().Count("input.dropped", sdl.droppedInput.exchange(0));
+    if (events > 0) {
+        GetProfiler().Sample("latency.input_to_tick", (timing.applied - oldest) / 1e6);
+    }
+}
+
+// Latency System:
+// Reports the timings of the frames the main thread has presented since the last frame: how long
+// after its input and after being published each frame reached the screen, the time between
+// presents, and how many display refreshes were missed in between.
+void LatencySystem::Update() {
+    auto& sdl = GetPersistentSingleton<SDLton>();
+    auto& profiler = GetProfiler();
+    FrameTiming timing;
+    int missed = 0;
+    while (sdl.presents.Pop(timing)) {
+        if (timing.input) {
+            profiler.Sample("latency.input_to_present", (timing.presented - timing.input) / 1e6);
+        }
+        profiler.Sample("latency.publish_to_present", (timing.presented - timing.published) / 1e6);
+        if (lastPresented) {
+            double interval = (timing.presented - lastPresented) / 1e6;
+            profiler.Sample("present.interval", interval);
+            // Anything over one and a half refreshes means at least one refresh showed the old frame
+            missed += std::max(0, (int)std::lround(interval / sdl.refreshInterval) - 1);
+        }
+        lastPresented = timing.presented;
+    }
+    profiler.Count("present.missed", missed);
+}
+
+// Input System:
+// Used for polling and handling events from SDL library. SDL only delivers events on the main
+// thread, so this runs there and pushes them with SDL's timestamps into the input ring. The
+// simulation never waits on this thread, and a slow frame on either side doesn't lose events.
+void InputSystem::Update() {
+    auto& sdl = GetPersistentSingleton<SDLton>();
+    auto push = [&sdl](InputEvent input) {
+        if (!sdl.input.Push(input)) {
+            sdl.droppedInput++;
+        }
+    };
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         // Quit game if X button pressed on the game window
         if (event.type == SDL_EVENT_QUIT) {
-            QuitGame();
+            push({ InputEvent::QUIT, SDL_SCANCODE_UNKNOWN, event.common.timestamp });
         }
-        else if (event.type == SDL_EVENT_KEY_DOWN) {
+        else if (event.type == SDL_EVENT_KEY_UP) {
+            push({ InputEvent::KEY_UP, event.key.scancode, event.common.timestamp });
+        }
+        else if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat) {
+            push({ InputEvent::KEY_DOWN, event.key.scancode, event.common.timestamp });
             // Check if F11 was pressed to toggle fullscreen
             if (event.key.scancode == SDL_SCANCODE_F11) {
                 Uint32 flags = SDL_GetWindowFlags(sdl.window);
@@ -26,7 +105,7 @@ void EventSystem::Update() {
             } 
             // Quit game if escape pressed
             else if (event.key.scancode == SDL_SCANCODE_ESCAPE) {
-                QuitGame();
+                push({ InputEvent::QUIT, SDL_SCANCODE_UNKNOWN, event.common.timestamp });
             }
         }
     }
@@ -38,15 +117,16 @@ void AsteroidSpawnSystem::Update() {
     auto& gen = GetSingleton<AsteroidGeneration>();
     // Generate new asteroid when counter is ready
     if (gen.nextAsteroidCounter == gen.nextAsteroidAt) {
+        auto& random = GetSingleton<RandomGenerator>().random;
         float xVel = 0;
         float yVel = 0;
         // Ensure nonzero velocity components.
         while (xVel == 0 || yVel == 0) {
-            xVel = (float)(rand() % 50 - 25) / 10;
-            yVel = (float)(rand() % 50 - 25) / 10;
+            xVel = (float)(random.Int(50) - 25) / 10;
+            yVel = (float)(random.Int(50) - 25) / 10;
         }
         // Create size from 0 to 2 (small to large)
-        int size = rand() % 3;
+        int size = random.Int(3);
         // Create an asteroid via the ObjectCreatorInterface interface.
         GetInterface<ObjectCreatorInterface>().CreateAsteroid({ -500, -500 }, { xVel, yVel }, size);
         // Reset timer for the next asteroid
@@ -60,145 +140,252 @@ void AsteroidSpawnSystem::Update() {
         gen.nextAsteroidAt = std::ceil(gen.nextAsteroidAt * 3 / 4.0f);
         gen.nextStageAt = std::ceil(gen.nextStageAt * 4 / 3.0f);
         gen.nextStageCounter = 0;
-        GetInterface<ObjectCreatorInterface>().CreateInstructions({ 1920 / 2 - 110, 1080 / 2 }, "Phase " + std::to_string(gen.stageNum), 240);
+        StartTask(GetInterface<ObjectCreatorInterface>().ShowInstructions({ 1920 / 2 - 110, 1080 / 2 }, "Phase " + std::to_string(gen.stageNum), 240));
         gen.stageNum++;
     }
     gen.nextAsteroidCounter++;
 }
 
-// Destroy System:
-// Destroys certain objects after their set duration.
-void DestroySystem::Update() {
-    for (Object object : ObjectsWith<DestroyTimer>()) {
-        auto& timer = object.GetComponent<DestroyTimer>();
-
-        if (timer.countdown <= 0) {
-            DestroyObject(object);
-        }
-        else {
-            timer.countdown--;
-        }
-    }
-}
-
 // AsteroidContainmentSystem:
 // System used for keeping asteroids within certain bounds, as well 
 // as checking for collisions.
 void AsteroidContainmentSystem::Update() {
-    for (auto asteroid : ObjectsWith("asteroid")) {
-        auto& xform = asteroid.GetComponent<Transform>();
-
-        // Move asteroid to other side of box if too far
-        if (xform.position.x > 4000)
-            xform.position.x = -1000;
-        else if (xform.position.x < -1000)
-            xform.position.x = 4000;
-        if (xform.position.y > 3000)
-            xform.position.y = -1000;
-        else if (xform.position.y < -1000)
-            xform.position.y = 3000;
+    auto& world = GetSingleton<World>();
+    auto& index = GetSingleton<SpatialIndex>();
+    float fastest = 0;
+    for (auto asteroid : ObjectsWith<Asteroid, Transform, Without<Dormant>>()) {
+        // Only take the transform for writing when it changes, so it isn't marked changed otherwise
+        auto& xform = asteroid.ReadComponent<Transform>();
+
+        // Move asteroid to other side of box if too far, along with where it came from
+        Vector2 wrapped = world.Wrap(xform.position);
+        if (wrapped.x != xform.position.x || wrapped.y != xform.position.y) {
+            auto& moved = asteroid.GetComponent<Transform>();
+            moved.previous += wrapped - moved.position;
+            moved.position = wrapped;
+        }
 
         // Get the size in pixels of the asteroid
-        int size;
-        if (asteroid.GetComponent<Asteroid>().size == 2)
-            size = 98;
-        else if (asteroid.GetComponent<Asteroid>().size == 1)
-            size = 64;
-        else
-            size = 16;
-
-        // Only check collisions for asteroids near the screen
+        float size = Radius(asteroid.ReadComponent<Asteroid>().size);
+
+        // Bullets can hit the asteroids whose path over the frame comes within reach of the bullet region
+        if (std::max(xform.previous.x, xform.position.x) >= world.bulletLeft - HIT_REACH &&
+            std::min(xform.previous.x, xform.position.x) <= world.bulletRight + HIT_REACH &&
+            std::max(xform.previous.y, xform.position.y) >= world.bulletTop - HIT_REACH &&
+            std::min(xform.previous.y, xform.position.y) <= world.bulletBottom + HIT_REACH) {
+            index.asteroids.Update(asteroid, xform.position.x, xform.position.y);
+            fastest = std::max(fastest, (xform.position - xform.previous).mag());
+        }
+        else {
+            index.asteroids.Remove(asteroid);
+        }
+
+        // Only check collisions with the ship for asteroids near the screen
         if (xform.position.x > -150 && xform.position.x < 2050 &&
             xform.position.y > -150 && xform.position.y < 1250) {
             // Check collision with ship
             for (auto ship : ObjectsWith("ship")) {
-                auto& shipxform = ship.GetComponent<Transform>();
+                auto& shipxform = ship.ReadComponent<Transform>();
                 //End the game if collision with ship
-                if ((shipxform.position - xform.position).mag() < size + 38) {
+                if (!ship.ReadComponent<Ship>().invulnerable && (shipxform.position - xform.position).mag() < size + 38) {
                     DestroyObject(ship);
-                    GetInterface<ObjectCreatorInterface>().CreateInstructions({ 1920 / 2 - 160, 1080 / 2 }, "GAME OVER", 500);
+                    StartTask(GetInterface<ObjectCreatorInterface>().ShowGameOver());
                     continue;
                 }
             }
-            // Check collision with bullet(s)
-            for (auto bullet : ObjectsWith("bullet")) {
-                auto& bulletxform = bullet.GetComponent<Transform>();
-                //Apply explosion force to ship from close impact
-                if ((bulletxform.position - xform.position).mag() < size + 16) {
-                    for (auto ship : ObjectsWith("ship")) {
-                        auto& shipxform = ship.GetComponent<Transform>();
-                        auto& shipcomp = ship.GetComponent<Ship>();
-                        shipcomp.reloadTimer = 0;
-                        float dist = (shipxform.position - bulletxform.position).mag();
-                        if (dist < 600) {
-                            shipxform.velocity +=
-                                Vector2::Unit((shipxform.position - bulletxform.position).angle())
-                                * 0.2f / std::pow(dist / 500.f, 2);
-                        }
-                    }
-                    // Create the explosion sprite
-                    Object e = CreateObject("explosion");
-                    e.GetComponent<Transform>().position = xform.position;
-                    e.GetComponent<SpriteRenderer>().sprite = "explosion";
-                    e.GetComponent<DestroyTimer>().countdown = 20;
-                    AddTag(e, "explosion");
-                    DestroyObject(asteroid);
-                    DestroyObject(bullet); 
-                    // Advance the score
-                    for (Object s : ObjectsWith<Score>()) {
-                        s.GetComponent<Score>().score++;
-                    }
-                }
-            }
         }
     }
+
+    GetProfiler().Count("asteroids.dormant", ObjectsWith<Dormant>().size());
+
+    CollideBullets(fastest);
 }
 
-// Score System:
-// Updates the score text.
-void ScoreSystem::Update() {
-    for (auto object : ObjectsWith<Score>()) {
-        auto& score = object.GetComponent<Score>();
-        auto& text = object.GetComponent<TextRenderer>();
+// Sweep each bullet from where it was to where it is against the asteroids near its path, moving
+// the asteroids over the frame as well. Since the paths are tested rather than the end positions,
+// fast bullets can't skip over small asteroids. Only the part of a path inside the bullet region
+// is tested, so where a bullet's last frame ends past the edge doesn't change what it hits.
+void AsteroidContainmentSystem::CollideBullets(float fastest) {
+    auto& world = GetSingleton<World>();
+    auto& index = GetSingleton<SpatialIndex>();
+    // Farthest a bullet's path can be from the center of an asteroid it hits, at either end of the frame
+    const float reach = HIT_REACH + fastest;
+
+    hits.clear();
+    for (auto bullet : ObjectsWith("bullet")) {
+        auto& b = bullet.ReadComponent<Transform>();
+        auto span = world.BulletSpan(b.previous, b.position);
+        if (span.first > span.second) {
+            continue;
+        }
+        Vector2 from = Vector2::lerp(b.previous, b.position, span.first);
+        Vector2 to = Vector2::lerp(b.previous, b.position, span.second);
+        candidates.clear();
+        index.asteroids.Query(std::min(from.x, to.x) - reach, std::min(from.y, to.y) - reach,
+            std::max(from.x, to.x) + reach, std::max(from.y, to.y) + reach, candidates);
+
+        // Test the path against every candidate in one batch, relative to each asteroid
+        int n = candidates.size();
+        startX.resize(n);
+        startY.resize(n);
+        moveX.resize(n);
+        moveY.resize(n);
+        radius.resize(n);
+        times.resize(n);
+        for (int i = 0; i < n; i++) {
+            auto& a = candidates[i].ReadComponent<Transform>();
+            Vector2 asteroidFrom = Vector2::lerp(a.previous, a.position, span.first);
+            Vector2 asteroidTo = Vector2::lerp(a.previous, a.position, span.second);
+            startX[i] = from.x - asteroidFrom.x;
+            startY[i] = from.y - asteroidFrom.y;
+            moveX[i] = (to.x - asteroidTo.x) - startX[i];
+            moveY[i] = (to.y - asteroidTo.y) - startY[i];
+            radius[i] = Radius(candidates[i].ReadComponent<Asteroid>().size) + BULLET_RADIUS;
+        }
+        SweepCircles(n);
+        for (int i = 0; i < n; i++) {
+            if (times[i] >= 0) {
+                // Back to a fraction of the whole frame
+                hits.push_back({ span.first + times[i] * (span.second - span.first), bullet, candidates[i] });
+            }
+        }
+    }
 
-        text.message = "Score: " + std::to_string(score.score);
+    // Take the hits in the order they happened, so a bullet or asteroid destroyed by an earlier hit
+    // can't be hit again later in the frame
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        return std::tie(a.time, a.bullet, a.asteroid) < std::tie(b.time, b.bullet, b.asteroid);
+    });
+    std::unordered_set<int> used;
+    for (auto& hit : hits) {
+        if (used.count(hit.bullet.GetID()) || used.count(hit.asteroid.GetID())) {
+            continue;
+        }
+        used.insert(hit.bullet.GetID());
+        used.insert(hit.asteroid.GetID());
+        auto& a = hit.asteroid.ReadComponent<Transform>();
+        auto& b = hit.bullet.ReadComponent<Transform>();
+        Vector2 asteroidAt = Vector2::lerp(a.previous, a.position, hit.time);
+        Vector2 bulletAt = Vector2::lerp(b.previous, b.position, hit.time);
+        DestroyObject(hit.asteroid);
+        DestroyObject(hit.bullet);
+        // Leave the effects of a hit to the hit system
+        SendEvent(AsteroidHit{ asteroidAt, bulletAt });
     }
 }
 
-// Instructions System:
-// Handles the flashing instructional text messages in the center of the screen.
-void InstructionsSystem::Update() {
-    for (auto object : ObjectsWith("instructions")) {
-        auto& tx = object.GetComponent<TextRenderer>();
-        auto& i = object.GetComponent<InstructionsTimer>();
-        
-        // Toggle the text's visibility to create flashing effect
-        if (i.timer > 0) {
-            tx.visible = (i.timer % 50) > 10;
-            i.timer--;
+// For each relative path, the fraction of the frame at which it first comes within the radius of
+// the origin, or -1 if it doesn't during the frame. Written as one loop over plain arrays so that
+// the compiler can vectorize it.
+void AsteroidContainmentSystem::SweepCircles(int n) {
+    for (int i = 0; i < n; i++) {
+        float a = moveX[i] * moveX[i] + moveY[i] * moveY[i];
+        float b = startX[i] * moveX[i] + startY[i] * moveY[i];
+        float c = startX[i] * startX[i] + startY[i] * startY[i] - radius[i] * radius[i];
+        // Solve |start + move * t| = radius for the earlier root
+        float discriminant = b * b - a * c;
+        float t = (-b - std::sqrt(std::max(discriminant, 0.f))) / std::max(a, 1e-12f);
+        times[i] = c < 0 ? 0 : (discriminant >= 0 && a > 0 && t >= 0 && t <= 1) ? t : -1;
+    }
+}
+
+// Size in pixels of an asteroid's hitbox
+float AsteroidContainmentSystem::Radius(int size) {
+    return size == 2 ? 98 : size == 1 ? 64 : 16;
+}
+
+// Asteroid Sleep System:
+// Puts the asteroids that drifted far from the screen to sleep until their path brings them back.
+// Dormant asteroids move exactly as awake ones would and are far outside the region checked for
+// collisions, so the frame an asteroid falls asleep on doesn't change the game.
+void AsteroidSleepSystem::Update() {
+    auto& world = GetSingleton<World>();
+    Resume(ObjectsWith<Asteroid, Transform, Without<Dormant>>(), RUNS, [&](Object asteroid) {
+        if (!world.Active(asteroid.ReadComponent<Transform>().position, world.sleepMargin)) {
+            Sleep(asteroid);
         }
-        else {
-            // Destroy the message after time expires, create further instructions (or exit game) if needed
-            SDL_DestroyTexture(tx.texture);
-            if (tx.message == "Press UP, DOWN, LEFT, RIGHT to fly.") {
-                GetInterface<ObjectCreatorInterface>().CreateInstructions({ 1920 / 2 - 350, 1080 / 2 }, "Press SPACE to shoot.", 300);
-            }
-            else if (tx.message == "GAME OVER") {
-                QuitGame();
+    });
+}
+
+// Stop moving an asteroid, and schedule it to wake up when its path next enters the active region
+void AsteroidSleepSystem::Sleep(Object asteroid) {
+    auto& world = GetSingleton<World>();
+    Transform xform = asteroid.ReadComponent<Transform>();
+    auto& dormant = AddComponent<Dormant>(asteroid);
+    dormant.origin = xform.position;
+    // The asteroid got to the origin at the end of the previous frame, and stops moving from this one
+    dormant.frame = FrameCount();
+    long long frames = world.FramesUntilActive(xform.position, xform.velocity * world.step);
+    if (frames >= 0) {
+        dormant.wake = ScheduleTimer(frames, [this, asteroid] { Wake(asteroid); });
+    }
+}
+
+// Move a sleeping asteroid to where it has drifted to and let it move frame by frame again
+void AsteroidSleepSystem::Wake(Object asteroid) {
+    auto& world = GetSingleton<World>();
+    Dormant dormant = asteroid.ReadComponent<Dormant>();
+    auto& xform = asteroid.GetComponent<Transform>();
+    xform.position = world.Advance(dormant.origin, xform.velocity * world.step, FrameCount() - dormant.frame);
+    xform.previous = xform.position;
+    RemoveComponent<Dormant>(asteroid);
+}
+
+// Asteroid Hit System:
+// Handles the previous frame's hits as one batch, creating the explosions, knocking
+// the ship back and advancing the score.
+void AsteroidHitSystem::Update() {
+    auto hits = ReadEvents<AsteroidHit>();
+    if (hits.empty()) {
+        return;
+    }
+
+    auto& particles = GetSingleton<Particles>();
+    for (auto& hit : hits) {
+        particles.explosions.Burst(Particles::FLASH, hit.position.x, hit.position.y);
+        particles.explosions.Burst(Particles::DEBRIS, hit.position.x, hit.position.y);
+    }
+
+    //Apply explosion force to ship from close impacts
+    for (auto ship : ObjectsWith("ship")) {
+        auto& shipxform = ship.ReadComponent<Transform>();
+        CancelTimer(ship.ReadComponent<Ship>().reload);
+        for (auto& hit : hits) {
+            float dist = (shipxform.position - hit.impact).mag();
+            if (dist < 600) {
+                ship.GetComponent<Transform>().velocity +=
+                    Vector2::Unit((shipxform.position - hit.impact).angle())
+                    * 0.2f / std::pow(dist / 500.f, 2);
             }
-            DestroyObject(object);
         }
     }
+
+    // Advance the score
+    for (Object s : ObjectsWith<Score>()) {
+        s.GetComponent<Score>().score += hits.size();
+    }
+}
+
+// Score System:
+// Updates the score text when the score changes.
+void ScoreSystem::Update() {
+    for (auto object : ObjectsWith<TextRenderer, Changed<Score>>()) {
+        auto& score = object.ReadComponent<Score>();
+        auto& text = object.GetComponent<TextRenderer>();
+
+        text.message = "Score: " + std::to_string(score.score);
+    }
 }
 
 // Bullet System: 
 // Destroys bullets after exiting the screen.
 void BulletSystem::Update() {
+    auto& world = GetSingleton<World>();
     for (auto bullet : ObjectsWith("bullet")) {
-        auto& xform = bullet.GetComponent<Transform>();
+        auto& xform = bullet.ReadComponent<Transform>();
 
-        if (xform.position.x < -200 || xform.position.x > 2100 ||
-            xform.position.y < -200 || xform.position.y > 1100) {
+        if (xform.position.x < world.bulletLeft || xform.position.x > world.bulletRight ||
+            xform.position.y < world.bulletTop || xform.position.y > world.bulletBottom) {
             DestroyObject(bullet);
         }
     }
@@ -207,40 +394,41 @@ void BulletSystem::Update() {
 // Movement System:
 // System for controlling the ship using directional keyboard input.
 void MovementSystem::Update() {
-    auto& sdl = GetPersistentSingleton<SDLton>();
+    auto& input = GetSingleton<InputState>();
 
     for (auto object : ObjectsWith("ship")) {
         auto& xform = object.GetComponent<Transform>();
-        auto& sr = object.GetComponent<SpriteRenderer>();
-        auto& ship = object.GetComponent<Ship>();
+        // The sprite and reload timer are only taken for writing when they change
+        std::string sprite = object.ReadComponent<SpriteRenderer>().sprite;
+        auto& ship = object.ReadComponent<Ship>();
 
         // Apply angular velocity for turning
-        if (sdl.keyboard[SDL_SCANCODE_RIGHT] || sdl.keyboard[SDL_SCANCODE_D]) {
+        if (input.Held(SDL_SCANCODE_RIGHT) || input.Held(SDL_SCANCODE_D)) {
             xform.angularVelocity += 0.5f;
         }
-        if (sdl.keyboard[SDL_SCANCODE_LEFT] || sdl.keyboard[SDL_SCANCODE_A]) {
+        if (input.Held(SDL_SCANCODE_LEFT) || input.Held(SDL_SCANCODE_A)) {
             xform.angularVelocity -= 0.5f;
         }
         // Apply "friction" to turn if not actively turning
-        if ((sdl.keyboard[SDL_SCANCODE_LEFT] || sdl.keyboard[SDL_SCANCODE_A]) ==
-            (sdl.keyboard[SDL_SCANCODE_RIGHT] || sdl.keyboard[SDL_SCANCODE_D])) {
+        if ((input.Held(SDL_SCANCODE_LEFT) || input.Held(SDL_SCANCODE_A)) ==
+            (input.Held(SDL_SCANCODE_RIGHT) || input.Held(SDL_SCANCODE_D))) {
             xform.angularVelocity *= 0.85f;
         }
 
         // Apply linear thrusting velocity for moving forwards/ backwards
-        if (sdl.keyboard[SDL_SCANCODE_UP] || sdl.keyboard[SDL_SCANCODE_W]) {
+        if (input.Held(SDL_SCANCODE_UP) || input.Held(SDL_SCANCODE_W)) {
             xform.velocity += Vector2{
                 std::cosf((xform.rotation - 90) * std::numbers::pi / 180),
                 std::sinf((xform.rotation - 90) * std::numbers::pi / 180)
             } *0.2f;
-            sr.sprite = "ship_accel";
+            sprite = "ship_accel";
         }
-        if (sdl.keyboard[SDL_SCANCODE_DOWN] || sdl.keyboard[SDL_SCANCODE_S]) {
+        if (input.Held(SDL_SCANCODE_DOWN) || input.Held(SDL_SCANCODE_S)) {
             xform.velocity -= Vector2{
                 std::cosf((xform.rotation - 90) * std::numbers::pi / 180),
                 std::sinf((xform.rotation - 90) * std::numbers::pi / 180)
             } *0.2f;
-            sr.sprite = "ship_reverse";
+            sprite = "ship_reverse";
         }
 
         // Cap the linear velocity if too large
@@ -266,46 +454,43 @@ void MovementSystem::Update() {
         xform.rotation += xform.angularVelocity;
 
         // Set the ship's sprite depending on its state
-        if (ship.reloadTimer > 0) {
-            sr.sprite = (sr.sprite == "ship") ? "ship_reloading" :
-                (sr.sprite == "ship_accel") ? "ship_accel_reloading" :
+        bool reloading = TimerPending(ship.reload);
+        if (reloading) {
+            sprite = (sprite == "ship") ? "ship_reloading" :
+                (sprite == "ship_accel") ? "ship_accel_reloading" :
                 "ship_reverse_reloading";
         }
+        if (sprite != object.ReadComponent<SpriteRenderer>().sprite) {
+            object.GetComponent<SpriteRenderer>().sprite = sprite;
+        }
 
-        // Fire a rocket if SPACE pressed and rocket available
-        if (sdl.keyboard[SDL_SCANCODE_SPACE] && ship.reloadTimer == 0 && !ship.spaceHeld) {
+        // Fire a rocket if SPACE was pressed since the last frame and rocket available
+        if (input.Pressed(SDL_SCANCODE_SPACE) && !reloading) {
             xform.velocity -= Vector2{
                 std::cosf((xform.rotation - 90) * std::numbers::pi / 180),
                 std::sinf((xform.rotation - 90) * std::numbers::pi / 180)
             } *0.8f;
             GetInterface<ObjectCreatorInterface>().CreateBullet(xform.position, xform.velocity, xform.rotation);
-            ship.reloadTimer = 60;
-        }
-        // Decrement reload timer
-        else if (ship.reloadTimer > 0) {
-            ship.reloadTimer--;
-        }
-        // Track the state of SPACE key press
-        if (sdl.keyboard[SDL_SCANCODE_SPACE]) {
-            ship.spaceHeld = true;
-        }
-        else {
-            ship.spaceHeld = false;
+            object.GetComponent<Ship>().reload = ScheduleTimer(60);
         }
     }
 }
 
 // Physics System:
-// Updates objects' positions by their velocities.
+// Updates objects' positions by their velocities, scaled to the tick rate. Text never
+// moves and dormant asteroids are moved when they wake up, so both are left out.
 void PhysicsSystem::Update() {
-    for (auto object : ObjectsWith<Transform>()) {
-        object.GetComponent<Transform>().position += object.GetComponent<Transform>().velocity;
+    float step = GetSingleton<World>().step;
+    for (auto object : ObjectsWith<Transform, Without<TextRenderer, Dormant>>()) {
+        auto& xform = object.GetComponent<Transform>();
+        xform.previous = xform.position;
+        xform.position += xform.velocity * step;
     }
 }
 
 // Render System:
 // Renders all visible objects to the screen.
-void RenderSys::Render(Transform& transform, SpriteRenderer& spriteRenderer) {      // Helper function for rendering an object to the screen
+void RenderSys::Queue(const Transform& transform, const SpriteRenderer& spriteRenderer) {      // Helper function for queueing an object's sprite
     auto& sdl = GetPersistentSingleton<SDLton>();
 
     auto sprite = sdl.GetSprite(spriteRenderer.sprite);
@@ -314,73 +499,140 @@ void RenderSys::Render(Transform& transform, SpriteRenderer& spriteRenderer) {
     const SDL_FRect destRect = { transform.position.x - rect.w * 2,
                                  transform.position.y - rect.h * 2,
                                  rect.w * 4, rect.h * 4 };
-    SDL_RenderTextureRotated(sdl.renderer, sprite.texture, &rect, &destRect, transform.rotation, nullptr, SDL_FLIP_NONE);
+    sdl.frames.Back().sprites.Push(spriteRenderer.layer, sprite.texture, transform.position.y, rect, destRect, transform.rotation);
 }
 
-// Render all visible objects to the screen.
-void RenderSys::Update() {      
-    // Render to a single texture before rendering to the screen 
+// Find the objects whose sprites overlap the screen, using the spatial index so that objects
+// far outside the screen aren't visited.
+std::vector<Object> RenderSys::Cull() {
     auto& sdl = GetPersistentSingleton<SDLton>();
-    SDL_SetRenderTarget(sdl.renderer, sdl.renderTexture);
+    auto& index = GetSingleton<SpatialIndex>();
 
-    // Clear and prepare the renderer
-    SDL_SetRenderDrawColor(sdl.renderer, sdl.bground.r, sdl.bground.g, sdl.bground.b, 255);
-    SDL_RenderClear(sdl.renderer);
+    // Move objects that changed since the last frame to their new cells
+    for (auto object : ObjectsWith<SpriteRenderer, Changed<Transform>>()) {
+        auto& xform = object.ReadComponent<Transform>();
+        index.grid.Update(object, xform.position.x, xform.position.y);
+    }
 
-    //Render objects by type so that they are rendered in the correct order:
-    // Render bullets.
-    for (auto bullet : ObjectsWith("bullet")) {
-        auto& spriteRenderer = bullet.GetComponent<SpriteRenderer>();
-        auto& xform = bullet.GetComponent<Transform>();
-        Render(xform, spriteRenderer);
+    std::vector<Object> candidates;
+    index.grid.Query(-CULL_MARGIN, -CULL_MARGIN, sdl.SCREEN_WIDTH + CULL_MARGIN, sdl.SCREEN_HEIGHT + CULL_MARGIN, candidates);
+
+    // Test each candidate's rotated sprite bounds against the screen
+    std::vector<Object> visible;
+    for (auto object : candidates) {
+        auto& xform = object.ReadComponent<Transform>();
+        auto clip = sdl.GetSprite(object.ReadComponent<SpriteRenderer>().sprite).clip;
+        float radius = std::max(clip.w, clip.h) * 2 * 1.415f;
+        if (xform.position.x + radius >= 0 && xform.position.x - radius <= sdl.SCREEN_WIDTH &&
+            xform.position.y + radius >= 0 && xform.position.y - radius <= sdl.SCREEN_HEIGHT) {
+            visible.push_back(object);
+        }
     }
-    // Render asteroids.
-    for (auto asteroid : ObjectsWith("asteroid")) {
-        auto& spriteRenderer = asteroid.GetComponent<SpriteRenderer>();
-        auto& xform = asteroid.GetComponent<Transform>();
-        Render(xform, spriteRenderer);
+
+    GetProfiler().Count("render.visible", visible.size());
+    GetProfiler().Count("render.culled", index.grid.Size() - visible.size());
+    return visible;
+}
+
+// Queue all visible objects in the frame being built for the main thread.
+void RenderSys::Update() {      
+    // Cull first, so that the spatial index stays up to date while resimulating
+    std::vector<Object> visible = Cull();
+
+    // Nothing is drawn while frames are being resimulated after a rollback
+    if (IsResimulating()) {
+        return;
     }
-    // Render ships.
-    for (auto ship : ObjectsWith("ship")) {
-        auto& spriteRenderer = ship.GetComponent<SpriteRenderer>();
-        auto& xform = ship.GetComponent<Transform>();
-        Render(xform, spriteRenderer);
+    auto& sdl = GetPersistentSingleton<SDLton>();
+
+    // Queue every visible sprite, then sort the queue so that layers are drawn in order and
+    // sprites sharing a texture are drawn together
+    auto& queue = sdl.frames.Back().sprites;
+    queue.Clear();
+    for (auto object : visible) {
+        Queue(object.ReadComponent<Transform>(), object.ReadComponent<SpriteRenderer>());
     }
-    // Render explosions.
-    for (auto explosion : ObjectsWith("explosion")) {
-        auto& spriteRenderer = explosion.GetComponent<SpriteRenderer>();
-        auto& xform = explosion.GetComponent<Transform>();
-        Render(xform, spriteRenderer);
+    queue.Sort();
+    GetProfiler().Count("render.batches", queue.Batches());
+}
+
+// Particle System:
+// Moves and expires the particles at the pace of the tick rate, then adds them to the frame being
+// built for the main thread.
+void ParticleSystem::Update() {
+    auto& particles = GetSingleton<Particles>();
+    particles.explosions.Update(GetSingleton<World>().step);
+    GetProfiler().Count("particles", particles.explosions.Size());
+
+    // Nothing is drawn while resimulating or running headless
+    auto& sdl = GetPersistentSingleton<SDLton>();
+    if (IsResimulating() || !sdl.renderer) {
+        return;
     }
+    auto sprite = sdl.GetSprite("explosion");
+    auto& batches = sdl.frames.Back().particles;
+    batches.resize(1);
+    batches[0].Clear();
+    batches[0].texture = sprite.texture;
+    batches[0].clip = { float(sprite.clip.x), float(sprite.clip.y), float(sprite.clip.w), float(sprite.clip.h) };
+    particles.explosions.Build(batches[0]);
 }
 
 // Text Render System:
-// Renders text to the screen and automatically updates textures when the message changes.
+// Adds the visible text messages to the frame, then publishes the finished frame to the main
+// thread. This is the last system of the frame.
 void TextRenderSystem::Update() {
+    if (IsResimulating()) {
+        return;
+    }
     auto& sdl = GetPersistentSingleton<SDLton>();
+    auto& frame = sdl.frames.Back();
 
+    frame.text.clear();
     for (auto object : ObjectsWith<TextRenderer>()) {
-        auto& tx = object.GetComponent<TextRenderer>();
-        // Check if text is visible...
+        auto& tx = object.ReadComponent<TextRenderer>();
         if (tx.visible) {
-            // Load new message if message changed
-            if (tx.message != tx.currentMessage) {
-                if (tx.texture) {
-                    SDL_DestroyTexture(tx.texture);
-                    tx.texture = nullptr;
-                }
-                tx.texture = sdl.LoadText(tx.message);
-                tx.currentMessage = tx.message;
-            }
-
-            // Render text
-            auto& xform = object.GetComponent<Transform>();
-            float w, h;
-            SDL_GetTextureSize(tx.texture, &w, &h);
-            SDL_FRect dstRect = { xform.position.x, xform.position.y, w, h };
-            SDL_RenderTexture(sdl.renderer, tx.texture, nullptr, &dstRect);
+            auto& xform = object.ReadComponent<Transform>();
+            frame.text.push_back({ tx.message, xform.position.x, xform.position.y });
         }
     }
+    frame.timing.tick = GetProfiler().Frames();
+    frame.timing.published = SDL_GetTicksNS();
+    sdl.frames.Publish();
+}
+
+// Present System:
+// Draws the newest frame published by the simulation and presents it. Text textures are cached
+// by message and freed once the message is no longer drawn.
+void PresentSystem::Update() {
+    auto& sdl = GetPersistentSingleton<SDLton>();
+    RenderFrame* frame = sdl.frames.Acquire(FRAME_WAIT);
+    if (!frame) {
+        return;
+    }
+    // Upload any sprites that finished loading since the last frame
+    sdl.UploadTextures();
+
+    // Render to a single texture before rendering to the screen 
+    SDL_SetRenderTarget(sdl.renderer, sdl.renderTexture);
+
+    // Clear and prepare the renderer
+    SDL_SetRenderDrawColor(sdl.renderer, sdl.bground.r, sdl.bground.g, sdl.bground.b, 255);
+    SDL_RenderClear(sdl.renderer);
+
+    frame->sprites.Flush(sdl.renderer, sdl.textures);
+    for (auto& batch : frame->particles) {
+        batch.Flush(sdl.renderer, sdl.textures);
+    }
+
+    for (auto& text : frame->text) {
+        SDL_Texture* texture = sdl.GetText(text.message);
+        float w, h;
+        SDL_GetTextureSize(texture, &w, &h);
+        SDL_FRect dstRect = { text.x, text.y, w, h };
+        SDL_RenderTexture(sdl.renderer, texture, nullptr, &dstRect);
+    }
+    sdl.EvictText();
 
     // Render the intermediate texture to the screen. This allows the aspect ratio to be maintained.
     SDL_SetRenderTarget(sdl.renderer, nullptr);
@@ -400,4 +652,8 @@ void TextRenderSystem::Update() {
                           static_cast<float>(scaledWidth), static_cast<float>(scaledHeight) };
     SDL_RenderTexture(sdl.renderer, sdl.renderTexture, nullptr, &dstRect);
     SDL_RenderPresent(sdl.renderer);
+
+    // Hand the frame's timings back to the simulation, which owns the profiler
+    frame->timing.presented = SDL_GetTicksNS();
+    sdl.presents.Push(frame->timing);
 }
\ No newline at end of file
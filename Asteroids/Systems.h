@@ -1,7 +1,9 @@
 #pragma once
 #include "ECSLib.h"
 #include "Components.h"
+#include <cstdint>
 
+// Event system: applies the input events captured on the main thread and quits the game if asked to.
 class EventSystem : public System {
 public:
     void Update() override;
@@ -13,26 +15,59 @@ public:
     void Update() override;
 };
 
-// Destroy system: checks destroy timers and destroys objects.
-class DestroySystem : public System {
+// Asteroid containment system: keeps asteroids within bounds and detects collisions.
+class AsteroidContainmentSystem : public System {
 public:
     void Update() override;
+
+private:
+    // Supporting struct for a bullet's path crossing an asteroid, at a fraction of the frame
+    struct Hit {
+        float time;
+        Object bullet;
+        Object asteroid;
+    };
+
+    // Radius of a bullet's hitbox, and the farthest an asteroid's center can be from a bullet it hits
+    const float BULLET_RADIUS = 16;
+    const float HIT_REACH = 98 + BULLET_RADIUS;
+
+    void CollideBullets(float fastest);
+    void SweepCircles(int n);
+    static float Radius(int size);
+
+    // Reused between frames to avoid allocating
+    std::vector<Object> candidates;
+    std::vector<float> startX, startY, moveX, moveY, radius, times;
+    std::vector<Hit> hits;
 };
 
-// Asteroid containment system: keeps asteroids within bounds and handles collisions.
-class AsteroidContainmentSystem : public System {
+// Asteroid sleep system: puts the asteroids far from the screen to sleep, checking a share of them
+// each run.
+class AsteroidSleepSystem : public System {
 public:
+    // Frames between runs, and runs it takes to check every awake asteroid
+    const int PERIOD = 2;
+    const int RUNS = 4;
+
+    AsteroidSleepSystem() {
+        RunEvery(PERIOD);
+    }
     void Update() override;
+
+private:
+    void Sleep(Object asteroid);
+    void Wake(Object asteroid);
 };
 
-// Score system: updates on-screen score text.
-class ScoreSystem : public System {
+// Asteroid hit system: applies the explosions, knockback, and score of the asteroids hit.
+class AsteroidHitSystem : public System {
 public:
     void Update() override;
 };
 
-// Instructions system: handles instruction messages (e.g. game over, phase indicators).
-class InstructionsSystem : public System {
+// Score system: updates on-screen score text.
+class ScoreSystem : public System {
 public:
     void Update() override;
 };
@@ -55,15 +90,49 @@ public:
     void Update() override;
 };
 
-// Render system: renders sprites for bullets, asteroids, ships, explosions.
+// Render system: culls off-screen sprites and queues the rest, then draws them sorted by layer and texture.
 class RenderSys : public System {
 public:
-    void Render(Transform& transform, SpriteRenderer& spriteRenderer);
+    // Distance outside the screen searched for sprites that may still overlap it
+    const float CULL_MARGIN = 192;
+
+    std::vector<Object> Cull();
+    void Queue(const Transform& transform, const SpriteRenderer& spriteRenderer);
     void Update() override;
 };
 
-// Text render system: renders text messages and manages render target swapping.
+// Particle system: updates the particle effects and adds them to the frame.
+class ParticleSystem : public System {
+public:
+    void Update() override;
+};
+
+// Text render system: adds visible text messages to the frame and hands the frame to the main thread.
 class TextRenderSystem : public System {
 public:
+    void Update() override;
+};
+
+// Latency system: reports the input latency and pacing of the frames the main thread presented.
+class LatencySystem : public System {
+public:
+    void Update() override;
+
+private:
+    uint64_t lastPresented = 0;
+};
+
+// Input system: polls SDL events on the main thread and passes the input on to the simulation.
+class InputSystem : public System {
+public:
+    void Update() override;
+};
+
+// Present system: draws the frames published by the simulation and presents them on the main thread.
+class PresentSystem : public System {
+public:
+    // Longest time to wait for a new frame before going back to polling input
+    const std::chrono::milliseconds FRAME_WAIT = std::chrono::milliseconds(5);
+
     void Update() override;
 };
\ No newline at end of file
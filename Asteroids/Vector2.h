@@ -27,33 +27,33 @@ struct Vector2 {
 		x = 0;
 		y = 0;
 	}
-	float mag() {
+	float mag() const {
 		return sqrtf(powf(x, 2) + powf(y, 2));
 	}
-	float angle() {
+	float angle() const {
 		return atan2f(y, x);
 	}
 	void operator=(float val) {
 		x = val;
 		y = val;
 	}
-	Vector2 operator+(Vector2 vec) {
+	Vector2 operator+(Vector2 vec) const {
 		Vector2 sum = { x + vec.x, y + vec.y };
 		return sum;
 	}
-	Vector2 operator-(Vector2 vec) {
+	Vector2 operator-(Vector2 vec) const {
 		Vector2 dif = { x - vec.x, y - vec.y };
 		return dif;
 	}
-	Vector2 operator*(float factor) {
+	Vector2 operator*(float factor) const {
 		Vector2 product = { x * factor, y * factor };
 		return product;
 	}
-	Vector2 operator*(Vector2 vector) {
+	Vector2 operator*(Vector2 vector) const {
 		Vector2 product = { x * vector.x, y * vector.y };
 		return product;
 	}
-	Vector2 operator/(float factor) {
+	Vector2 operator/(float factor) const {
 		Vector2 product = { x / factor, y / factor };
 		return product;
 	}
@@ -73,7 +73,7 @@ struct Vector2 {
 		x /= divisor;
 		y /= divisor;
 	}
-	bool operator==(Vector2 comparator) {
+	bool operator==(Vector2 comparator) const {
 		return (x == comparator.x && y == comparator.y);
 	}
 };
\ No newline at end of file
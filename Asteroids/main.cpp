@@ -1,36 +1,74 @@
 #include "SDL3/SDL_main.h"
 #include "ECSLib.h"
+#include "WorldRunner.h"
 #include "Vector2.h"
 #include "Components.h"
 #include "Interfaces.h"
 #include "Singletons.h"
 #include "Systems.h"
+#include "Stress.h"
+
+// Base of the scenes where asteroids are played, which share the components, the object types, and
+// what happens when objects are removed, so the scenes can't drift apart.
+class GameplayScene : public Scene {
+protected:
+	// Register the components and define the object types, keeping the spatial indexes and the
+	// sleeping asteroids up to date as objects are removed
+	void DefineGameplay() {
+		RegisterComponents<Transform, SpriteRenderer,Asteroid,
+			TextRenderer,Score,Ship,Dormant>();
+		CreateSingleton<SpatialIndex>();
+
+		DefineObject<Transform,SpriteRenderer,Ship>("ship");
+		DefineObject<Transform,SpriteRenderer,Asteroid>("asteroid");
+		DefineObject<Transform,SpriteRenderer>("bullet");
+		DefineObject<Transform,TextRenderer,Score>("scoreboard");
+		DefineObject<Transform,TextRenderer>("instructions");
+
+		// Keep destroyed sprites out of the spatial indexes used for culling and collisions
+		SpatialIndex* index = &GetSingleton<SpatialIndex>();
+		OnRemove<SpriteRenderer>([index](const std::vector<std::pair<Object, SpriteRenderer>>& removed) {
+			for (auto& sprite : removed) {
+				index->grid.Remove(sprite.first);
+				index->asteroids.Remove(sprite.first);
+			}
+		});
+		// Asteroids destroyed while asleep mustn't be woken up
+		OnRemove<Dormant>([this](const std::vector<std::pair<Object, Dormant>>& removed) {
+			for (auto& dormant : removed) {
+				CancelTimer(dormant.second.wake);
+			}
+		});
+	}
+};
 
 // This is the "Scene" where the game is played. Components, interfaces, and systems must be registered
 // to be part of the scene. 
-class AsteroidsScene : public Scene {
+class AsteroidsScene : public GameplayScene {
 	// This is the initialization function used to register the needed classes for the scene. Object types 
 	// are then defined, and the starting objects can be created.
 	void Init() {
-		RegisterComponents<Transform, SpriteRenderer,Asteroid,DestroyTimer,
-			TextRenderer,Score,InstructionsTimer,Ship>();
-		RegisterSystems<EventSystem,AsteroidSpawnSystem,AsteroidContainmentSystem,ScoreSystem,
-			DestroySystem,BulletSystem,MovementSystem,PhysicsSystem,InstructionsSystem,RenderSys,TextRenderSystem>();
+		DefineGameplay();
+		RegisterSystems<EventSystem,LatencySystem,AsteroidSpawnSystem,AsteroidHitSystem,AsteroidContainmentSystem,AsteroidSleepSystem,ScoreSystem,
+			BulletSystem,MovementSystem,PhysicsSystem,ParticleSystem,RenderSys,TextRenderSystem>();
+		// Input and presentation run on the main thread while the systems above simulate the next frame
+		RegisterSystems<InputSystem,PresentSystem>(PRESENT_BATCH);
 		CreateInterfaces<ObjectCreatorInterface>();
+		// Close the holes left by destroyed asteroids and bullets in the spare time of each frame
+		EnableCompaction(0.25);
 		CreateSingleton<AsteroidGeneration>();
-
-		DefineObject<Transform,SpriteRenderer,Ship>("ship");
-		DefineObject<Transform,SpriteRenderer,Asteroid>("asteroid");
-		DefineObject<Transform,SpriteRenderer>("bullet");
-		DefineObject<Transform,SpriteRenderer,DestroyTimer>("explosion");
-		DefineObject<Transform,TextRenderer,Score>("scoreboard");
-		DefineObject<Transform,TextRenderer,InstructionsTimer>("instructions");
+		CreateSingleton<World>();
+		CreateSingleton<Particles>();
+		CreateSingleton<RandomGenerator>();
+		CreateSingleton<InputState>();
+		GetSingleton<Particles>().explosions.SetRandom(GetSingleton<RandomGenerator>().random.Stream(RandomGenerator::PARTICLE_STREAM));
 
 		Object ship = CreateObject("ship");
 		ship.GetComponent<Transform>().position = { 1920/2,1080/2 };
 		ship.GetComponent<Transform>().velocity = { 0,0 };
 		ship.GetComponent<Transform>().rotation = 0;
 		ship.GetComponent<SpriteRenderer>().sprite = "ship";
+		ship.GetComponent<SpriteRenderer>().layer = LAYER_SHIPS;
 		AddTag(ship, "ship");
 
 		Object score = CreateObject("scoreboard");
@@ -38,39 +76,108 @@ class AsteroidsScene : public Scene {
 		score.GetComponent<Score>().score = 0;
 		score.GetComponent<TextRenderer>().message = "Score: 0";
 
-		Object instructions = CreateObject("instructions");
-		instructions.GetComponent<Transform>().position = { 1920 / 2-525,1080 / 2 };
-		instructions.GetComponent<TextRenderer>().message = "Press UP, DOWN, LEFT, RIGHT to fly.";
-		instructions.GetComponent<InstructionsTimer>().timer = 300;
-		AddTag(instructions, "instructions");
+		StartTask(GetInterface<ObjectCreatorInterface>().ShowIntro());
+	}
+};
+
+// Scene for measuring how the game scales. Asteroids are spawned up to each target count while an
+// autopilot ship fires continuously, and the profiler's measurements are printed at each target.
+class StressScene : public GameplayScene {
+	void Init() {
+		auto& config = GetPersistentSingleton<StressConfig>();
+		DefineGameplay();
+		RegisterSystems<StressSpawnSystem,AsteroidHitSystem,AsteroidContainmentSystem,AsteroidSleepSystem,BulletSystem,
+			AutopilotSystem,PhysicsSystem,ParticleSystem,StressReportSystem>();
+		if (!config.headless) {
+			RegisterSystems<EventSystem,LatencySystem,RenderSys,TextRenderSystem>();
+			RegisterSystems<InputSystem,PresentSystem>(PRESENT_BATCH);
+		}
+		CreateInterfaces<ObjectCreatorInterface>();
+		EnableCompaction(0.25);
+		CreateSingleton<Particles>();
+		CreateSingleton<World>();
+		CreateSingleton<StressProgress>();
+		CreateSingleton<RandomGenerator>();
+		CreateSingleton<InputState>();
+		GetSingleton<RandomGenerator>().random.Seed(config.seed);
+		GetSingleton<Particles>().explosions.SetRandom(GetSingleton<RandomGenerator>().random.Stream(RandomGenerator::PARTICLE_STREAM));
+
+		// Center the world on the screen
+		auto& world = GetSingleton<World>();
+		world.left = 1920 / 2 - config.worldWidth / 2;
+		world.right = 1920 / 2 + config.worldWidth / 2;
+		world.top = 1080 / 2 - config.worldHeight / 2;
+		world.bottom = 1080 / 2 + config.worldHeight / 2;
+		// Velocities are per 60 Hz frame, so other tick rates move everything by a fraction or multiple of them
+		SetTickRate(config.tickRate);
+		world.step = 60.f / config.tickRate;
 	}
 };
 
 // This is the Game class representing the runnable application. Inside, we can create and initialize persistent
 // Singletons, as well as register the scenes used by the game.
 class AsteroidsGame : public Game {
+public:
+	AsteroidsGame(StressConfig _stress = StressConfig()) {
+		stress = _stress;
+	}
+
 protected:
 	void Init() {
 		// Create a Singleton for rendering data, accessible across Scenes
-		CreatePersistentSingletons<SDLton>();
+		CreatePersistentSingletons<SDLton,StressConfig>();
+		GetPersistentSingleton<StressConfig>() = stress;
 		auto& sdl = GetPersistentSingleton<SDLton>();
-		// Access and initialize the renderer Singleton
-		sdl.SDLInit();
+		// Access and initialize the renderer Singleton, unless running headless
+		if (!stress.headless) {
+			sdl.SDLInit();
+		}
 
 		//Register scenes
 		RegisterScene<AsteroidsScene>("AsteroidsScene");
+		RegisterScene<StressScene>("StressScene");
 	}
 
 	// Close the renderer and free memory on application exit
 	void Quit() {
-		GetPersistentSingleton<SDLton>().SDLClose();
+		if (!stress.headless) {
+			GetPersistentSingleton<SDLton>().SDLClose();
+		}
 	}
+
+private:
+	StressConfig stress;
 };
 
 int main(int argc, char** argv) {
+	// Bake the sprite assets into a pre-decoded pack instead of running the game
+	if (argc > 2 && std::string(argv[1]) == "--pack") {
+		return SDLton::PackAssets(argv[2]) ? 0 : 1;
+	}
+
+	// Run the stress test instead of the game, e.g. "--stress --headless --targets 10000,100000"
+	StressConfig stress;
+	if (!stress.Parse(argc, argv)) {
+		return 1;
+	}
+
+	// Simulate many headless stress worlds on every core, e.g. "--stress --headless --worlds 64 --targets 1000"
+	if (stress.worlds > 1) {
+		WorldRunner runner;
+		for (int i = 0; i < stress.worlds; i++) {
+			StressConfig config = stress;
+			config.seed = stress.seed + i;
+			runner.Add(std::make_shared<AsteroidsGame>(config), "StressScene");
+		}
+		auto total = runner.RunAll();
+		printf("%d worlds on %d threads: %lld ticks in %.0f ms, %.0f ticks/sec, %.0f ticks/sec/core\n", runner.Size(), runner.Threads(),
+			total.ticks, total.milliseconds, total.TicksPerSecond(), total.TicksPerCoreSecond());
+		return 0;
+	}
+
 	// Create and start the game
-	AsteroidsGame game;
-	game.Start("AsteroidsScene");
+	AsteroidsGame game(stress);
+	game.Start(stress.enabled ? "StressScene" : "AsteroidsScene");
 
 	return 0;
 }
\ No newline at end of file
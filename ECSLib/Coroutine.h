@@ -0,0 +1,301 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <cmath>
+#include <algorithm>
+
+// Task Class:
+// The return type of a coroutine that runs across frames. A task does nothing until it is
+// started with StartTask or awaited by another task, after which it runs up to its first
+// co_await and is then resumed by the scene's TaskScheduler once what it waits for is due.
+class Task {
+public:
+	struct promise_type;
+
+	// Supporting struct for finishing a task, which resumes the task that awaited it or
+	// hands a started task back to the scheduler to be freed
+	struct FinalAwaiter {
+		bool await_ready() noexcept {
+			return false;
+		}
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+		void await_resume() noexcept {}
+	};
+
+	struct promise_type {
+		Task get_return_object() {
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+		FinalAwaiter final_suspend() noexcept {
+			return {};
+		}
+		void return_void() {}
+		void unhandled_exception() {
+			exception = std::current_exception();
+		}
+
+		std::coroutine_handle<> continuation;
+		std::exception_ptr exception;
+		long long id = 0;	// The scheduler's id for a started task, 0 for one that is awaited
+	};
+
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	Task& operator=(Task&& other) noexcept {
+		if (this != &other) {
+			if (handle) {
+				handle.destroy();
+			}
+			handle = std::exchange(other.handle, nullptr);
+		}
+		return *this;
+	}
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+	~Task() {
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	// Awaiting a task runs it to completion inside the awaiting task
+	bool await_ready() {
+		return !handle || handle.done();
+	}
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+		handle.promise().continuation = awaiting;
+		return handle;
+	}
+	void await_resume() {
+		if (handle && handle.promise().exception) {
+			std::rethrow_exception(handle.promise().exception);
+		}
+	}
+
+private:
+	explicit Task(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+
+	std::coroutine_handle<promise_type> handle;
+	friend class TaskScheduler;
+};
+
+// TaskScheduler Class:
+// Owns the started tasks of a scene and resumes them once per frame. Sleeping tasks are kept
+// ordered by the frame they wake on, so only the ones that are due are touched and a sleeping
+// task costs nothing until then. Tasks waiting on a condition are the exception, since the
+// condition has to be checked every frame. Each waiting coroutine is kept with the id of the
+// started task it belongs to, so that a started task can be cancelled wherever it is waiting.
+class TaskScheduler {
+public:
+	TaskScheduler() = default;
+	TaskScheduler(TaskScheduler&& other) noexcept {
+		*this = std::move(other);
+	}
+	TaskScheduler& operator=(TaskScheduler&& other) noexcept {
+		if (this != &other) {
+			Clear();
+			sleeping = std::exchange(other.sleeping, {});
+			polling = std::exchange(other.polling, {});
+			roots = std::exchange(other.roots, {});
+			nextID = other.nextID;
+			frame = other.frame;
+			tickRate = other.tickRate;
+		}
+		return *this;
+	}
+	TaskScheduler(const TaskScheduler&) = delete;
+	TaskScheduler& operator=(const TaskScheduler&) = delete;
+	~TaskScheduler() {
+		Clear();
+	}
+
+	// Take ownership of a task and run it up to its first co_await. Returns the id to cancel it
+	// by, or 0 if there was nothing to start.
+	long long Start(Task task) {
+		auto handle = std::exchange(task.handle, nullptr);
+		if (!handle) {
+			return 0;
+		}
+		long long id = ++nextID;
+		handle.promise().id = id;
+		roots[id] = handle;
+		Resume(handle, id);
+		return id;
+	}
+
+	// Destroy a started task without resuming it, along with the tasks it is awaiting. Returns
+	// whether it was still pending.
+	bool Cancel(long long id) {
+		auto root = roots.find(id);
+		if (root == roots.end()) {
+			return false;
+		}
+		std::erase_if(sleeping, [id](auto& entry) { return entry.second.task == id; });
+		std::erase_if(polling, [id](auto& wait) { return wait.second.task == id; });
+		auto handle = root->second;
+		roots.erase(root);
+		handle.destroy();
+		return true;
+	}
+
+	// Advance to the next frame and resume every task that is due, returning how many were resumed
+	int Run() {
+		frame++;
+		int resumed = 0;
+		// Conditions are checked first so that a task woken by a timer this frame waits for the next check
+		auto waiting = std::exchange(polling, {});
+		for (auto& wait : waiting) {
+			if (wait.first()) {
+				Resume(wait.second.handle, wait.second.task);
+				resumed++;
+			}
+			else {
+				polling.push_back(std::move(wait));
+			}
+		}
+		while (!sleeping.empty() && sleeping.begin()->first <= frame) {
+			auto waiting = sleeping.begin()->second;
+			sleeping.erase(sleeping.begin());
+			Resume(waiting.handle, waiting.task);
+			resumed++;
+		}
+		return resumed;
+	}
+
+	// Destroy every task without resuming it
+	void Clear() {
+		sleeping.clear();
+		polling.clear();
+		for (auto& root : roots) {
+			root.second.destroy();
+		}
+		roots.clear();
+	}
+
+	// Number of started tasks that haven't finished yet
+	int Size() const {
+		return roots.size();
+	}
+	long long Frame() const {
+		return frame;
+	}
+	// The number of frames per second, used to turn Seconds into frames
+	void SetTickRate(int ticksPerSecond) {
+		tickRate = ticksPerSecond;
+	}
+	int TickRate() const {
+		return tickRate;
+	}
+
+	// The scheduler resuming tasks on this thread, for the awaiters to register with
+	static TaskScheduler& Current() {
+		return *running;
+	}
+
+	// Wake the task after the given number of frames
+	void Sleep(std::coroutine_handle<> handle, long long frames) {
+		sleeping.insert({ frame + std::max(1LL, frames), { handle, current } });
+	}
+	// Wake the task on the first frame the condition holds
+	void Poll(std::coroutine_handle<> handle, std::function<bool()> condition) {
+		polling.push_back({ std::move(condition), { handle, current } });
+	}
+
+private:
+	// Supporting struct for a suspended coroutine and the started task it belongs to
+	struct Waiting {
+		std::coroutine_handle<> handle;
+		long long task;
+	};
+
+	void Resume(std::coroutine_handle<> handle, long long task) {
+		auto previous = std::exchange(running, this);
+		auto previousTask = std::exchange(current, task);
+		handle.resume();
+		running = previous;
+		current = previousTask;
+		// Free the started tasks that just finished, passing on the first error among them
+		std::exception_ptr error;
+		for (auto root : std::exchange(finished, {})) {
+			if (!error) {
+				error = root.promise().exception;
+			}
+			roots.erase(root.promise().id);
+			root.destroy();
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	std::multimap<long long, Waiting> sleeping;
+	std::vector<std::pair<std::function<bool()>, Waiting>> polling;
+	std::unordered_map<long long, std::coroutine_handle<Task::promise_type>> roots;
+	std::vector<std::coroutine_handle<Task::promise_type>> finished;
+	long long nextID = 0;
+	long long current = 0;	// The started task being resumed
+	long long frame = 0;
+	int tickRate = 60;
+	static inline thread_local TaskScheduler* running = nullptr;
+	friend struct Task::FinalAwaiter;
+};
+
+inline std::coroutine_handle<> Task::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+	if (handle.promise().continuation) {
+		return handle.promise().continuation;
+	}
+	TaskScheduler::running->finished.push_back(handle);
+	return std::noop_coroutine();
+}
+
+// Supporting struct for waiting a number of frames, or a number of seconds at the scheduler's tick rate
+struct WaitAwaiter {
+	double amount;
+	bool seconds;
+
+	bool await_ready() {
+		return amount <= 0;
+	}
+	void await_suspend(std::coroutine_handle<> handle) {
+		auto& scheduler = TaskScheduler::Current();
+		scheduler.Sleep(handle, seconds ? (long long)std::ceil(amount * scheduler.TickRate()) : (long long)amount);
+	}
+	void await_resume() {}
+};
+
+// Supporting struct for waiting until a condition holds
+struct UntilAwaiter {
+	std::function<bool()> condition;
+
+	bool await_ready() {
+		return condition();
+	}
+	void await_suspend(std::coroutine_handle<> handle) {
+		TaskScheduler::Current().Poll(handle, std::move(condition));
+	}
+	void await_resume() {}
+};
+
+// Resume the task on the next frame
+inline WaitAwaiter NextFrame() {
+	return { 1,false };
+}
+// Resume the task after the given number of frames
+inline WaitAwaiter Frames(int frames) {
+	return { (double)frames,false };
+}
+// Resume the task after the given number of seconds, rounded up to whole frames
+inline WaitAwaiter Seconds(double seconds) {
+	return { seconds,true };
+}
+// Resume the task on the first frame the condition is true, e.g. once an asset has loaded
+inline UntilAwaiter Until(std::function<bool()> condition) {
+	return { std::move(condition) };
+}
@@ -7,52 +7,450 @@
 #include <queue>
 #include <iostream>
 #include <set>
+#include <deque>
+#include <array>
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include <optional>
+#include <chrono>
 #include <boost/dynamic_bitset.hpp>
+#include "Rollback.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "TripleBuffer.h"
+#include "SPSCRing.h"
+#include "Memory.h"
+#include "Coroutine.h"
+#include "TimerWheel.h"
+#include "Events.h"
 
 // Dummy class to be derived by singleton components
 class Singleton {
 
 };
 
+// Query filters:
+// Used in ObjectsWith to only get the objects whose component of type T was modified (Changed)
+// or created (Added) since the calling system last ran.
+template <class T> struct Changed {};
+template <class T> struct Added {};
+// Query terms:
+// Used in ObjectsWith to leave out the objects that have any of the given components (Without),
+// or to note a component the system reads when present without requiring it (Optional), which is
+// then accessed through Object::TryGetComponent or TryReadComponent. Queries with these terms are
+// kept up to date as groups like any other query.
+template <class...Ts> struct Without {};
+template <class T> struct Optional {};
+
+template <class T> struct QueryTerm {
+	using Component = T;
+	static const bool filter = false;
+	static const bool required = true;
+	static const bool excluded = false;
+};
+template <class T> struct QueryTerm<Changed<T>> {
+	using Component = T;
+	static const bool filter = true;
+	static const bool added = false;
+	static const bool required = true;
+	static const bool excluded = false;
+};
+template <class T> struct QueryTerm<Added<T>> {
+	using Component = T;
+	static const bool filter = true;
+	static const bool added = true;
+	static const bool required = true;
+	static const bool excluded = false;
+};
+template <class...Ts> struct QueryTerm<Without<Ts...>> {
+	static const bool filter = false;
+	static const bool required = false;
+	static const bool excluded = true;
+};
+template <class T> struct QueryTerm<Optional<T>> {
+	using Component = T;
+	static const bool filter = false;
+	static const bool required = false;
+	static const bool excluded = false;
+};
+
+// Readable name of a type, without the "class " prefix some compilers put on type names
+template <class T> std::string TypeName() {
+	std::string name = typeid(T).name();
+	if (name.find(' ') != std::string::npos) {
+		name = name.substr(name.find(' ') + 1);
+	}
+	return name;
+}
+
 // Component Array Class:
-// Stores an array of components and provides functions for accessing them.
+// Stores an array of components and provides functions for accessing them. Components are kept
+// in fixed-size pages so that the rollback buffer can save a copy of just the pages that were
+// written during a frame.
 class ICompArray {
 public:
 	virtual void CreateComponent(int o) = 0;
 	virtual void DestroyComponent(int o) = 0;
+	virtual MemoryStats Memory() = 0;	// Leaves the name to the caller
+	virtual std::string Name() = 0;
+	virtual int Compact(int maxSteps, bool byObject) = 0;
+
+	// Whether the last compaction pass finished and no component was created or destroyed since
+	bool Compacted() {
+		return compactedVersion == version;
+	}
+
+	// Forget logged changes that no system can still see
+	void TrimChanges(int tick) {
+		Trim(changes, tick);
+		Trim(additions, tick);
+	}
+
+	// Logs of (tick, object) for the first modification/creation of a component in each tick
+	std::vector<std::pair<int, int>>& Changes(bool added) {
+		return added ? additions : changes;
+	}
 
 protected:
-	std::unordered_map<int, int> objectIDs;
-	std::queue<int> availableIDs;
+	bool Recording() {
+		return rollback && rollback->Recording();
+	}
+
+	static void Trim(std::vector<std::pair<int, int>>& log, int tick) {
+		auto end = std::find_if(log.begin(), log.end(), [tick](auto& entry) { return entry.first > tick; });
+		log.erase(log.begin(), end);
+	}
+
+	std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, CountingAllocator<std::pair<const int, int>>> objectIDs;
+	std::deque<int, CountingAllocator<int>> availableIDs;
+	std::vector<std::pair<int, int>> changes;
+	std::vector<std::pair<int, int>> additions;
+	int version = 0;	// Increases whenever a component is created or destroyed
+	int compactedVersion = 0;
+	RollbackBuffer* rollback = nullptr;
+	int* changeTick = nullptr;
+
+	friend class CompArrays;
 };
 template <class T> class CompArray : public ICompArray {
 public:
+	static const int PAGE_SIZE = 64;
+
 	void CreateComponent(int o) {
+		// Compaction can fill a free slot without removing it from the list, so skip those
+		while (!availableIDs.empty() && slotObjects[availableIDs.front()] >= 0) {
+			int stale = availableIDs.front();
+			availableIDs.pop_front();
+			if (Recording()) {
+				rollback->Record([this, stale] { availableIDs.push_front(stale); });
+			}
+		}
+		int slot;
 		if (availableIDs.empty()) {
-			components.push_back(T());
-			objectIDs.insert({ o,components.size() - 1 });
+			slot = count;
+			if (slot % PAGE_SIZE == 0) {
+				pages.push_back(std::make_unique<Page>());
+				pages.back()->generation = rollback ? rollback->Generation() : 0;
+			}
+			count++;
+			slotObjects.push_back(o);
+			if (Recording()) {
+				rollback->Record([this] {
+					count--;
+					slotObjects.pop_back();
+					if (count % PAGE_SIZE == 0) {
+						pages.pop_back();
+					}
+				});
+			}
 		}
 		else {
-			components[availableIDs.front()] = T();
-			objectIDs.insert({ o,availableIDs.front() });
-			availableIDs.pop();
+			slot = availableIDs.front();
+			availableIDs.pop_front();
+			slotObjects[slot] = o;
+			if (Recording()) {
+				rollback->Record([this, slot] {
+					availableIDs.push_front(slot);
+					slotObjects[slot] = -1;
+				});
+			}
+		}
+		Write(slot) = T();
+		version++;
+		Page& page = *pages[slot / PAGE_SIZE];
+		page.added[slot % PAGE_SIZE] = *changeTick;
+		additions.push_back({ *changeTick,o });
+		MarkChanged(slot, o);
+		objectIDs.insert({ o,slot });
+		if (Recording()) {
+			rollback->Record([this, o] { objectIDs.erase(o); });
 		}
 	}
 
 	void DestroyComponent(int o) {
-		GetComponent(o) = T();
-		availableIDs.push(objectIDs[o]);
+		int slot = objectIDs[o];
+		Write(slot) = T();
+		version++;
+		availableIDs.push_back(slot);
 		objectIDs.erase(o);
+		slotObjects[slot] = -1;
+		if (Recording()) {
+			rollback->Record([this, o, slot] {
+				objectIDs[o] = slot;
+				availableIDs.pop_back();
+				slotObjects[slot] = o;
+			});
+		}
 	}
 
+	// Mutable access, which marks the component as changed in the current tick
 	T& GetComponent(int o) {
-		return components[objectIDs[o]];
+		int slot = objectIDs[o];
+		T& component = Write(slot);
+		MarkChanged(slot, o);
+		return component;
+	}
+
+	const T& ReadComponent(int o) {
+		int slot = objectIDs[o];
+		return pages[slot / PAGE_SIZE]->items[slot % PAGE_SIZE];
+	}
+
+	// Check whether the object's component was modified (or created) after the given tick
+	bool ChangedSince(int o, int tick, bool added) {
+		auto it = objectIDs.find(o);
+		if (it == objectIDs.end()) {
+			return false;
+		}
+		Page& page = *pages[it->second / PAGE_SIZE];
+		return (added ? page.added : page.changed)[it->second % PAGE_SIZE] > tick;
 	}
 
 	int size() { return availableIDs.size(); }
 
+	std::string Name() {
+		return TypeName<T>();
+	}
+
+	// Move components toward the front of the array, in order of object ID (or keeping their
+	// current order), closing the holes left by destroyed components. Objects keep their IDs,
+	// so handles stay valid. A pass visits each component once and can be spread over many
+	// calls, each visiting up to the given number of components; when it finishes, the empty
+	// pages at the end are freed. Returns the number of components visited.
+	int Compact(int maxSteps, bool byObject) {
+		if (Compacted()) {
+			return 0;
+		}
+		if (Recording()) {
+			// Rewinding past this point invalidates the pass's progress
+			rollback->Record([this] { version++; });
+		}
+		if (compactOrder.empty()) {
+			StartCompaction(byObject);
+		}
+
+		// Put each object of the pass into the next slot, swapping out whatever is there
+		int steps = 0;
+		for (; compactCursor < compactOrder.size() && steps < maxSteps; compactCursor++, steps++) {
+			auto it = objectIDs.find(compactOrder[compactCursor]);
+			if (it == objectIDs.end()) {
+				continue;
+			}
+			int o = it->first;
+			int from = it->second;
+			int to = compactNext++;
+			if (from == to) {
+				continue;
+			}
+			int other = slotObjects[to];
+			SwapSlots(from, to);
+			MoveObject(o, to);
+			if (other >= 0) {
+				MoveObject(other, from);
+			}
+			else {
+				// The free slot that was filled is skipped when it comes up in the free list
+				availableIDs.push_back(from);
+				if (Recording()) {
+					rollback->Record([this] { availableIDs.pop_back(); });
+				}
+			}
+		}
+
+		if (compactCursor == compactOrder.size()) {
+			FinishCompaction();
+		}
+		return steps;
+	}
+
+
+	MemoryStats Memory() {
+		MemoryStats stats;
+		stats.live = objectIDs.size();
+		stats.capacity = pages.size() * PAGE_SIZE;
+		stats.free = stats.capacity - stats.live;
+		stats.bytes = pages.size() * sizeof(Page) + pages.capacity() * sizeof(std::unique_ptr<Page>) +
+			objectIDs.bucket_count() * sizeof(void*) + objectIDs.size() * (sizeof(std::pair<const int, int>) + 2 * sizeof(void*)) +
+			(availableIDs.size() + slotObjects.capacity()) * sizeof(int) + (changes.capacity() + additions.capacity()) * sizeof(std::pair<int, int>);
+		return stats;
+	}
+
 private:
-	std::vector<T> components;
+	struct Page {
+		int generation = 0;
+		std::array<T, PAGE_SIZE> items;
+		std::array<int, PAGE_SIZE> changed;
+		std::array<int, PAGE_SIZE> added;
+
+		Page() {
+			changed.fill(-1);
+			added.fill(-1);
+		}
+
+		// Report page allocations to the AllocationCounter
+		static void* operator new(size_t bytes) {
+			AllocationCounter::Allocated(bytes);
+			return ::operator new(bytes);
+		}
+		static void operator delete(void* page, size_t bytes) {
+			AllocationCounter::Freed(bytes);
+			::operator delete(page);
+		}
+	};
+
+	void MarkChanged(int slot, int o) {
+		int& tick = pages[slot / PAGE_SIZE]->changed[slot % PAGE_SIZE];
+		if (tick != *changeTick) {
+			tick = *changeTick;
+			changes.push_back({ tick,o });
+		}
+	}
+
+	// Mutable access to a slot. The first write to a page in a frame saves a copy of it so
+	// the frame can be undone.
+	T& Write(int slot) {
+		Page& page = *pages[slot / PAGE_SIZE];
+		if (Recording() && page.generation != rollback->Generation()) {
+			page.generation = rollback->Generation();
+			int p = slot / PAGE_SIZE;
+			auto copy = std::make_shared<Page>(page);
+			rollback->Record([this, p, copy] { *pages[p] = *copy; });
+		}
+		return page.items[slot % PAGE_SIZE];
+	}
+
+	// Exchange the contents and change ticks of two slots without marking them changed
+	void SwapSlots(int a, int b) {
+		std::swap(Write(a), Write(b));
+		Page& pageA = *pages[a / PAGE_SIZE];
+		Page& pageB = *pages[b / PAGE_SIZE];
+		std::swap(pageA.changed[a % PAGE_SIZE], pageB.changed[b % PAGE_SIZE]);
+		std::swap(pageA.added[a % PAGE_SIZE], pageB.added[b % PAGE_SIZE]);
+	}
+
+	// Point an object at a new slot, and the slot back at the object
+	void MoveObject(int o, int slot) {
+		int from = objectIDs[o];
+		objectIDs[o] = slot;
+		int previous = slotObjects[slot];
+		slotObjects[slot] = o;
+		if (from != slot && slotObjects[from] == o) {
+			slotObjects[from] = -1;
+		}
+		if (Recording()) {
+			rollback->Record([this, o, from, slot, previous] {
+				if (slotObjects[from] < 0) {
+					slotObjects[from] = o;
+				}
+				slotObjects[slot] = previous;
+				objectIDs[o] = from;
+			});
+		}
+	}
+
+	// List the live objects in the order they should end up in: by object ID, or by slot
+	void StartCompaction(bool byObject) {
+		if (byObject) {
+			// Object IDs are dense, so they can be sorted by marking them off in a table
+			int maxID = -1;
+			for (int o : slotObjects) {
+				maxID = std::max(maxID, o);
+			}
+			std::vector<bool> present(maxID + 1);
+			for (int o : slotObjects) {
+				if (o >= 0) {
+					present[o] = true;
+				}
+			}
+			for (int o = 0; o <= maxID; o++) {
+				if (present[o]) {
+					compactOrder.push_back(o);
+				}
+			}
+		}
+		else {
+			for (int o : slotObjects) {
+				if (o >= 0) {
+					compactOrder.push_back(o);
+				}
+			}
+		}
+		compactCursor = 0;
+		compactNext = 0;
+		compactStartVersion = version;
+	}
+
+	// Drop the free slots at the end of the array and the pages they leave empty, and rebuild
+	// the free list so that the lowest free slots are handed out first
+	void FinishCompaction() {
+		int oldCount = count;
+		while (count > 0 && slotObjects[count - 1] < 0) {
+			count--;
+		}
+		slotObjects.resize(count);
+		auto freed = std::make_shared<std::vector<std::unique_ptr<Page>>>();
+		while (pages.size() > (count + PAGE_SIZE - 1) / PAGE_SIZE) {
+			freed->push_back(std::move(pages.back()));
+			pages.pop_back();
+		}
+		auto freeSlots = std::make_shared<std::deque<int, CountingAllocator<int>>>(std::move(availableIDs));
+		availableIDs.clear();
+		for (int slot = 0; slot < count; slot++) {
+			if (slotObjects[slot] < 0) {
+				availableIDs.push_back(slot);
+			}
+		}
+		if (Recording()) {
+			rollback->Record([this, oldCount, freed, freeSlots] {
+				count = oldCount;
+				slotObjects.resize(count, -1);
+				while (!freed->empty()) {
+					pages.push_back(std::move(freed->back()));
+					freed->pop_back();
+				}
+				availableIDs = *freeSlots;
+			});
+		}
+		else if (pages.capacity() > 2 * pages.size()) {
+			pages.shrink_to_fit();
+		}
+
+		compactOrder = std::vector<int>();
+		// Components created or destroyed during the pass need another one
+		if (compactStartVersion == version) {
+			compactedVersion = version;
+		}
+	}
+
+	std::vector<std::unique_ptr<Page>> pages;
+	int count = 0;
+	// State of the compaction pass in progress
+	std::vector<int> compactOrder;
+	int compactCursor = 0;
+	int compactNext = 0;
+	int compactStartVersion = 0;
+	std::vector<int> slotObjects;	// Object in each slot, or -1 if the slot is free
 };
 
 // CompArrays Class:
@@ -65,6 +463,8 @@ public:
 		compIDs[typeid(T).name()] = nextCompID;
 		nextCompID++;
 		compArrays[compIDs[typeid(T).name()]] = std::make_shared<CompArray<T>>();
+		compArrays[compIDs[typeid(T).name()]]->rollback = rollback;
+		compArrays[compIDs[typeid(T).name()]]->changeTick = changeTick;
 		RegisterComponent<Ts...>();
 	}
 
@@ -72,6 +472,10 @@ public:
 		return GetComponentArray<T>()->GetComponent(o);
 	}
 
+	template <class T> const T& ReadComponent(int o) {
+		return GetComponentArray<T>()->ReadComponent(o);
+	}
+
 	template <class T> std::shared_ptr<CompArray<T>> GetComponentArray() {
 		return std::static_pointer_cast<CompArray<T>>(compArrays[compIDs[typeid(T).name()]]);
 	}
@@ -88,12 +492,17 @@ public:
 		return nextCompID;
 	}
 
+	RollbackBuffer* rollback = nullptr;
+	int* changeTick = nullptr;
+
 private:
 	std::unordered_map<const char*, int> compIDs;
 	std::unordered_map<int, std::shared_ptr<ICompArray>> compArrays;
 	int nextCompID = 0;
 };
 
+class GameData;
+
 // Object Class:
 // Represents an object in the game, this class is used to access its components.
 class Object {
@@ -106,6 +515,10 @@ public:
 		return this->id < other.id;
 	}
 
+	int GetID() const {
+		return id;
+	}
+
 	template <class T> T& GetComponent() {
 		return compArrays->GetComponent<T>(id);
 	}
@@ -114,13 +527,120 @@ public:
 		return const_cast<T&>(compArrays->GetComponent<T>(id));
 	}
 
+	template <class T> T& AddComponent();
+	template <class T> void SetComponent(T value);
+	template <class T> void RemoveComponent();
+	template <class T> bool HasComponent();
+	// Pointers to the component, or nullptr if the object doesn't have one
+	template <class T> T* TryGetComponent();
+	template <class T> const T* TryReadComponent() const;
+
+	// Read-only access, which unlike GetComponent doesn't mark the component as changed
+	template <class T> const T& ReadComponent() const {
+		return compArrays->ReadComponent<T>(id);
+	}
+
 private:
 	int id;
 	CompArrays* compArrays;
+	GameData* gameData;
 
 	friend class GameData;
 };
 
+// Supporting struct identifying an object in a way that can tell when it is gone, even once its
+// ID has been reused or a rewind has taken the object away. A default handle refers to no object.
+struct ObjectHandle {
+	int id = -1;
+	long long generation = 0;
+};
+
+// A sorted set of objects, as used for groups and tags
+using ObjectSet = std::set<Object, std::less<Object>, CountingAllocator<Object>>;
+
+// Component Observers Class:
+// Holds the callbacks registered for one component type and the events waiting to be delivered
+// to them. Events are collected as components are added, set, and removed, and delivered in
+// batches when the game data is flushed, so that derived structures can be updated
+// incrementally. Removed components are copied before they are cleared so that cleanup
+// callbacks can release what they own.
+class IComponentObservers {
+public:
+	virtual ~IComponentObservers() {}
+	virtual void Added(int o) = 0;
+	virtual void Set(int o) = 0;
+	virtual void Removed(int o, CompArrays& compArrays) = 0;
+	virtual bool Pending() = 0;
+	virtual void Flush(const std::function<Object(int)>& object) = 0;
+};
+template <class T> class ComponentObservers : public IComponentObservers {
+public:
+	using ObjectCallback = std::function<void(const std::vector<Object>&)>;
+	using RemoveCallback = std::function<void(const std::vector<std::pair<Object, T>>&)>;
+
+	void Added(int o) {
+		if (!onAdd.empty()) {
+			added.push_back(o);
+		}
+	}
+	void Set(int o) {
+		if (!onSet.empty()) {
+			set.push_back(o);
+		}
+	}
+	void Removed(int o, CompArrays& compArrays) {
+		if (!onRemove.empty()) {
+			removed.push_back({ o,compArrays.ReadComponent<T>(o) });
+		}
+	}
+	bool Pending() {
+		return !added.empty() || !set.empty() || !removed.empty();
+	}
+
+	void Flush(const std::function<Object(int)>& object) {
+		// Swap the events out first so callbacks can cause new ones
+		if (!added.empty()) {
+			std::vector<Object> batch;
+			for (int o : added) {
+				batch.push_back(object(o));
+			}
+			added.clear();
+			for (auto& callback : onAdd) {
+				callback(batch);
+			}
+		}
+		if (!set.empty()) {
+			std::vector<Object> batch;
+			for (int o : set) {
+				batch.push_back(object(o));
+			}
+			set.clear();
+			for (auto& callback : onSet) {
+				callback(batch);
+			}
+		}
+		if (!removed.empty()) {
+			std::vector<std::pair<Object, T>> batch;
+			for (auto& entry : removed) {
+				batch.push_back({ object(entry.first),std::move(entry.second) });
+			}
+			removed.clear();
+			for (auto& callback : onRemove) {
+				callback(batch);
+			}
+		}
+	}
+
+	std::vector<ObjectCallback> onAdd;
+	std::vector<ObjectCallback> onSet;
+	std::vector<RemoveCallback> onRemove;
+
+private:
+	std::vector<int> added;
+	std::vector<int> set;
+	std::vector<std::pair<int, T>> removed;
+};
+
 // EventInterface Class:
 // Not to be confused with the user-derived GInterface, this class tracks
 // whether scenes should be switched or the game should be exited.
@@ -139,6 +659,12 @@ public:
 	std::pair<bool, std::string> ShouldSwitchScene() {
 		return { switchScene,scene };
 	}
+	// Ask the game to start building a scene in the background ahead of switching to it
+	void PreloadScene(std::string _scene) {
+		if (preloadScene) {
+			preloadScene(_scene);
+		}
+	}
 	void Reset() {
 		quit = false;
 		switchScene = false;
@@ -148,6 +674,9 @@ private:
 	bool quit = false;
 	bool switchScene = false;
 	std::string scene;
+	std::function<void(std::string)> preloadScene;
+
+	friend class Game;
 };
 
 // GameData Class:
@@ -163,13 +692,24 @@ public:
 	}
 
 	template <class T> T& GetSingleton() {
-		return *(std::static_pointer_cast<T>(singletons[typeid(T).name()]));
+		auto singleton = std::static_pointer_cast<T>(singletons[typeid(T).name()]);
+		// Save the singleton's state the first time it is accessed in a frame
+		if (rollback.Recording() && singletonGenerations[typeid(T).name()] != rollback.Generation()) {
+			singletonGenerations[typeid(T).name()] = rollback.Generation();
+			auto copy = std::make_shared<T>(*singleton);
+			rollback.Record([singleton, copy] { *singleton = *copy; });
+		}
+		return *singleton;
 	}
 	template <class T> T& GetPersistentSingleton() {
 		return *(std::static_pointer_cast<T>(persistentSingletons->at(typeid(T).name())));
 	}
 
-	template<class...Ts> void RegisterComponent() { compArrays.RegisterComponent<Ts...>(); }
+	template<class...Ts> void RegisterComponent() {
+		compArrays.rollback = &rollback;
+		compArrays.changeTick = &changeTick;
+		compArrays.RegisterComponent<Ts...>();
+	}
 
 	template<class...Ts> typename std::enable_if<sizeof...(Ts) == 0>::type DefineObject(std::string name) {}
 	template<class T, class...Ts> void DefineObject(std::string name) {
@@ -183,23 +723,40 @@ public:
 		boost::dynamic_bitset<> signature = objectDefinitions[name];
 		if (availableObjIDs.empty()) {
 			objectSignatures.push_back(signature);
+			objectGenerations.push_back(++nextGeneration);
+			signatureBlocks += signature.num_blocks();
 			o = objectSignatures.size() - 1;
+			if (rollback.Recording()) {
+				rollback.Record([this] {
+					signatureBlocks -= objectSignatures.back().num_blocks();
+					objectSignatures.pop_back();
+					objectGenerations.pop_back();
+				});
+			}
 		}
 		else {
 			o = availableObjIDs.front();
-			availableObjIDs.pop();
-			objectSignatures[o] = signature;
+			availableObjIDs.pop_front();
+			SetSignature(o, signature);
+			objectGenerations[o] = ++nextGeneration;
+			if (rollback.Recording()) {
+				rollback.Record([this, o] {
+					objectSignatures[o].reset();
+					objectGenerations[o] = 0;
+					availableObjIDs.push_front(o);
+				});
+			}
 		}
 
 		for (int i = 0; i < signature.size(); i++) {
 			if (signature[i]) {
 				GetComponentArray(i)->CreateComponent(o);
+				NotifyAdded(i, o);
 			}
 		}
-		for (int i = 0; i < groupSigs.size(); i++) {
-			if ((groupSigs[i] & signature) == groupSigs[i]) {
-				groups[i].insert(ConstructObject(o));
-			}
+		AddToGroups(o);
+		if (rollback.Recording()) {
+			rollback.Record([this, o] { RemoveFromGroups(o); });
 		}
 		return ConstructObject(o);
 	}
@@ -209,21 +766,126 @@ public:
 		boost::dynamic_bitset<> sig = objectSignatures[o];
 		for (int i = 0; i < sig.size(); i++) {
 			if (sig[i]) {
+				NotifyRemoved(i, o);
 				GetComponentArray(i)->DestroyComponent(o);
 			}
 		}
-		for (int i = 0; i < groupSigs.size(); i++) {
-			if ((groupSigs[i] & sig) == groupSigs[i]) {
-				Object temp = Object();
-				temp.id = o;
-				groups[i].erase(temp);
-			}
-		}
+		RemoveFromGroups(o);
+		std::vector<std::string> removedTags;
 		for (auto& tagSet : tags) {
-			tagSet.second.erase(ConstructObject(o));
+			if (tagSet.second.erase(ConstructObject(o)) && rollback.Recording()) {
+				removedTags.push_back(tagSet.first);
+			}
 		}
-		availableObjIDs.push(o);
+		availableObjIDs.push_back(o);
 		objectSignatures[o].reset();
+		long long generation = std::exchange(objectGenerations[o], 0);
+		if (rollback.Recording()) {
+			rollback.Record([this, o, sig, removedTags, generation] {
+				availableObjIDs.pop_back();
+				SetSignature(o, sig);
+				objectGenerations[o] = generation;
+				AddToGroups(o);
+				for (auto& tag : removedTags) {
+					tags[tag].insert(ConstructObject(o));
+				}
+			});
+		}
+	}
+
+	// Register callbacks for when components of type T are added to objects, explicitly set
+	// with SetComponent, or removed from objects (including when the object is destroyed)
+	template <class T> void OnAdd(typename ComponentObservers<T>::ObjectCallback callback) {
+		GetObservers<T>().onAdd.push_back(callback);
+	}
+	template <class T> void OnSet(typename ComponentObservers<T>::ObjectCallback callback) {
+		GetObservers<T>().onSet.push_back(callback);
+	}
+	template <class T> void OnRemove(typename ComponentObservers<T>::RemoveCallback callback) {
+		GetObservers<T>().onRemove.push_back(callback);
+	}
+
+	// Replace an object's component, notifying the OnSet observers
+	template <class T> void SetComponent(Object e, T value) {
+		GetComponent<T>(e.id) = std::move(value);
+		auto it = observers.find(GetCompID<T>());
+		if (it != observers.end()) {
+			it->second->Set(e.id);
+		}
+	}
+
+	// Deliver the observer events collected since the last flush
+	void FlushObservers() {
+		bool pending = true;
+		// Callbacks may cause further events, which are delivered in the same flush
+		for (int pass = 0; pending && pass < 16; pass++) {
+			pending = false;
+			for (auto& observer : observers) {
+				if (observer.second->Pending()) {
+					observer.second->Flush([this](int o) { return ConstructObject(o); });
+					pending = true;
+				}
+			}
+		}
+	}
+
+	// Give an existing object a component. Only the groups that mention the component are
+	// re-evaluated.
+	template <class T> T& AddComponent(Object e) {
+		int o = e.id;
+		int c = GetCompID<T>();
+		if (objectSignatures[o].size() <= c) {
+			signatureBlocks -= objectSignatures[o].num_blocks();
+			objectSignatures[o].resize(compArrays.NumberComponents());
+			signatureBlocks += objectSignatures[o].num_blocks();
+		}
+		if (!objectSignatures[o][c]) {
+			objectSignatures[o].set(c);
+			GetComponentArray(c)->CreateComponent(o);
+			NotifyAdded(c, o);
+			UpdateGroups(o, c, true);
+			if (rollback.Recording()) {
+				rollback.Record([this, o, c] {
+					UpdateGroups(o, c, false);
+					objectSignatures[o].reset(c);
+				});
+			}
+		}
+		return GetComponent<T>(o);
+	}
+
+	// Take a component away from an existing object
+	template <class T> void RemoveComponent(Object e) {
+		int o = e.id;
+		int c = GetCompID<T>();
+		if (objectSignatures[o].size() > c && objectSignatures[o][c]) {
+			UpdateGroups(o, c, false);
+			NotifyRemoved(c, o);
+			GetComponentArray(c)->DestroyComponent(o);
+			objectSignatures[o].reset(c);
+			if (rollback.Recording()) {
+				rollback.Record([this, o, c] {
+					objectSignatures[o].set(c);
+					UpdateGroups(o, c, true);
+				});
+			}
+		}
+	}
+
+	template <class T> bool HasComponent(Object e) {
+		int c = GetCompID<T>();
+		return objectSignatures[e.id].size() > c && objectSignatures[e.id][c];
+	}
+
+	ObjectHandle Handle(Object e) {
+		return { e.id, objectGenerations[e.id] };
+	}
+	// The object a handle refers to, or nothing if it has been destroyed or rewound away
+	std::optional<Object> Resolve(ObjectHandle handle) {
+		if (handle.id < 0 || handle.id >= (int)objectGenerations.size() || objectGenerations[handle.id] != handle.generation) {
+			return std::nullopt;
+		}
+		return ConstructObject(handle.id);
 	}
 
 	void SetPersistentSingletons(GameData* data) {
@@ -234,43 +896,245 @@ public:
 		return GetComponentArray<T>()->GetComponent(e);
 	}
 
-	template<class ...Ts> std::set<Object>& ObjectsWith() {
-		boost::dynamic_bitset<> sig = GetSignature<Ts...>();
-		if (!groupInit[sig]) {
+	// Get the objects with all the given components and none of the Without ones. With Changed/Added
+	// filters this returns a list built from the components' change logs rather than a stored group.
+	template<class ...Ts> decltype(auto) ObjectsWith() {
+		if constexpr ((QueryTerm<Ts>::filter || ...)) {
+			return FilteredObjects<Ts...>();
+		}
+		else {
+			return GroupObjects<Ts...>();
+		}
+	}
+
+	template<class ...Ts> ObjectSet& GroupObjects() {
+		static_assert((QueryTerm<Ts>::required || ...), "A query needs at least one required component");
+		boost::dynamic_bitset<> sig = QuerySignature<Ts...>();
+		boost::dynamic_bitset<> excluded = ExcludedSignature<Ts...>();
+		boost::dynamic_bitset<> key = GroupKey(sig, excluded);
+		if (!groupInit[key]) {
 			groupSigs.push_back(sig);
-			groups.push_back(std::set<Object>());
-			groupIDs[sig] = nextGroupID;
+			groupExcludes.push_back(excluded);
+			groups.push_back(ObjectSet());
+			groupIDs[key] = nextGroupID;
+			compGroups.resize(compArrays.NumberComponents());
+			// Adding or removing an excluded component moves objects in or out of the group as well
+			boost::dynamic_bitset<> mentioned = sig | excluded;
+			for (int c = mentioned.find_first(); c != mentioned.npos; c = mentioned.find_next(c)) {
+				compGroups[c].push_back(nextGroupID);
+			}
 			for (int i = 0; i < objectSignatures.size(); i++) {
 				if (ObjInGroup(i, nextGroupID)) {
 					groups[nextGroupID].insert(ConstructObject(i));
 				}
 			}
-			groupInit[sig] = true;
+			groupInit[key] = true;
 			nextGroupID++;
-			return (groups[groupIDs[sig]]);
+			return (groups[groupIDs[key]]);
 		}
 		else {
-			return (groups[groupIDs[sig]]);
+			return (groups[groupIDs[key]]);
 		}
 	}
 
-	std::set<Object>& ObjectsWith(std::string tag) {
+	ObjectSet& ObjectsWith(std::string tag) {
 		return tags[tag];
 	}
 
+	// Mark the start of a system's run for change detection. Changes are visible to a system
+	// when they were made after the tick it last ran at.
+	int BeginSystem(int lastRunTick) {
+		queryTick = lastRunTick;
+		return ++changeTick;
+	}
+	void TrimChanges(int tick) {
+		for (int i = 0; i < compArrays.NumberComponents(); i++) {
+			GetComponentArray(i)->TrimChanges(tick);
+		}
+	}
+
 	bool ObjInGroup(int e, int g) {
-		return (groupSigs[g] & objectSignatures[e]) == groupSigs[g];
+		return (groupSigs[g] & objectSignatures[e]) == groupSigs[g] && !groupExcludes[g].intersects(objectSignatures[e]);
 	}
 
 	template <class ...Ts> int GetGroupID() {
-		return groupIDs[GetSignature<Ts...>()];
+		return groupIDs[GroupKey(QuerySignature<Ts...>(), ExcludedSignature<Ts...>())];
 	}
 
 	void AddTag(Object o, std::string tag) {
-		tags[tag].insert(o);
+		if (tags[tag].insert(o).second && rollback.Recording()) {
+			rollback.Record([this, o, tag] { tags[tag].erase(o); });
+		}
+	}
+
+	// Keep journals for the given number of past frames so that the game state can be rewound
+	void EnableRollback(int frames) {
+		rollback.Enable(frames);
+	}
+	// Seal the changes made during the current frame into the rollback buffer
+	void CommitFrame() {
+		rollback.Commit();
+	}
+	// Restore the game state to how it was the given number of frames ago. Tasks started during
+	// the rewound frames are cancelled. The others can't be rewound and carry on from where they
+	// were, so they should hold the objects they use by ObjectHandle.
+	int Rewind(int frames) {
+		return rollback.Rewind(frames);
+	}
+
+	// Start a task, journaling it so that a rewind to before it started cancels it
+	void StartTask(Task task) {
+		long long id = tasks.Start(std::move(task));
+		if (id != 0 && rollback.Recording()) {
+			rollback.Record([this, id] { tasks.Cancel(id); });
+		}
+	}
+	RollbackBuffer& GetRollback() {
+		return rollback;
+	}
+
+	// Call the callback (which may be empty) once the given number of frames have passed. Timers
+	// are advanced after the default systems each frame, and are rewound like everything else.
+	TimerHandle ScheduleTimer(long long frames, std::function<void()> callback = {}) {
+		return timers.Schedule(frames, std::move(callback), rollback);
+	}
+	bool CancelTimer(TimerHandle timer) {
+		return timers.Cancel(timer, rollback);
+	}
+	bool TimerPending(TimerHandle timer) {
+		return timers.Pending(timer);
+	}
+	long long TimerRemaining(TimerHandle timer) {
+		return timers.Remaining(timer);
+	}
+	// Number of frames the scene has finished, which goes up as the timers are advanced
+	long long FrameCount() {
+		return timers.Now();
+	}
+	// Move the timers on by a frame, returning how many fired
+	int AdvanceTimers() {
+		return timers.Advance(rollback);
+	}
+
+	// Send an event to be read by any system during the next frame
+	template <class T> void SendEvent(T event) {
+		GetEvents<T>().Send(std::move(event), rollback);
+	}
+	// The events of type T sent during the previous frame, in the order they were sent
+	template <class T> std::span<const T> ReadEvents() {
+		return GetEvents<T>().Read();
+	}
+	// Hand the events sent this frame over to the readers, returning how many were sent
+	int SwapEvents() {
+		int sent = 0;
+		for (auto& channel : channels) {
+			sent += channel.second->Swap(rollback);
+		}
+		return sent;
+	}
+
+	// Compact the component arrays, visiting up to the given number of components in total
+	// (see CompArray::Compact). Returns whether every array is compact.
+	bool Compact(int maxSteps, bool byObject = true) {
+		bool compacted = true;
+		for (int c = 0; c < compArrays.NumberComponents(); c++) {
+			auto array = GetComponentArray(c);
+			if (!array->Compacted() && maxSteps > 0) {
+				maxSteps -= array->Compact(maxSteps, byObject);
+			}
+			compacted = compacted && array->Compacted();
+		}
+		return compacted;
+	}
+
+	// Compact the component arrays a little at the end of every frame, for up to the given
+	// number of milliseconds (0 disables it). Ordering by object ID lines up the components of
+	// objects that are queried together, since groups are visited in object ID order.
+	void EnableCompaction(double milliseconds, bool byObject = true) {
+		compactionBudget = milliseconds;
+		compactByObject = byObject;
+	}
+	void RunCompaction() {
+		if (compactionBudget <= 0) {
+			return;
+		}
+		auto start = std::chrono::steady_clock::now();
+		while (!Compact(COMPACTION_STEP, compactByObject) && Profiler::Since(start) < compactionBudget) {}
+		profiler.Count("compaction", Profiler::Since(start));
+	}
+
+	// Memory use of the object table and of every component array, group, and tag
+	std::vector<MemoryStats> MemoryReport() {
+		std::vector<MemoryStats> report;
+		report.push_back(ObjectMemory());
+		report.back().name = "objects";
+		for (int c = 0; c < compArrays.NumberComponents(); c++) {
+			report.push_back(ArrayMemory(c));
+			report.back().name = "component:" + GetComponentArray(c)->Name();
+		}
+		for (int g = 0; g < groups.size(); g++) {
+			report.push_back(GroupMemory(g));
+			report.back().name = "group:";
+			for (int c = groupSigs[g].find_first(); c != groupSigs[g].npos; c = groupSigs[g].find_next(c)) {
+				report.back().name += (c == groupSigs[g].find_first() ? "" : ",") + GetComponentArray(c)->Name();
+			}
+			for (int c = groupExcludes[g].find_first(); c != groupExcludes[g].npos; c = groupExcludes[g].find_next(c)) {
+				report.back().name += ",!" + GetComponentArray(c)->Name();
+			}
+		}
+		for (auto& tag : tags) {
+			report.push_back(TagMemory(tag.first));
+			report.back().name = "tag:" + tag.first;
+		}
+		return report;
+	}
+	void DumpMemoryJSON(std::ostream& out) {
+		MemoryStats::WriteJSON(out, MemoryReport());
+	}
+
+	// Count the allocations made on this thread toward the scene until the matching StopCounting.
+	// Nested calls, such as the frames stepped while resimulating, are counted once.
+	void StartCounting() {
+		if (countingDepth++ == 0) {
+			countingMark = AllocationCounter::Current();
+		}
+	}
+	void StopCounting() {
+		if (--countingDepth == 0) {
+			allocationsCounted += AllocationCounter::Current() - countingMark;
+		}
+	}
+
+	// Update the memory high-water marks and report the allocations the scene made since the last
+	// sample to the profiler. Must be called between StartCounting and StopCounting.
+	void SampleMemory() {
+		ObjectMemory();
+		for (int c = 0; c < compArrays.NumberComponents(); c++) {
+			ArrayMemory(c);
+		}
+		for (int g = 0; g < groups.size(); g++) {
+			GroupMemory(g);
+		}
+		for (auto& tag : tags) {
+			TagMemory(tag.first);
+		}
+		auto now = AllocationCounter::Current();
+		allocationsCounted += now - countingMark;
+		countingMark = now;
+		auto sampled = allocationsCounted - allocationsSampled;
+		profiler.Count("memory.allocations", sampled.allocations);
+		profiler.Count("memory.allocatedBytes", sampled.allocatedBytes);
+		profiler.Count("memory.liveBytes", allocationsCounted.allocatedBytes - allocationsCounted.freedBytes);
+		allocationsSampled = allocationsCounted;
 	}
 
 	EventInterface eventInterface;
+	Profiler profiler;
+	bool resimulating = false;
+	std::pair<int, bool> rollbackRequest = { 0,false };
+	// Coroutines started by the scene's systems and interfaces
+	TaskScheduler tasks;
+	TimerWheel timers;
 
 private:
 	template <class T> std::shared_ptr<CompArray<T>> GetComponentArray() {
@@ -285,10 +1149,177 @@ private:
 		return compArrays.GetCompID<T>();
 	}
 
+	template<class ...Ts> std::vector<Object> FilteredObjects() {
+		boost::dynamic_bitset<> sig = QuerySignature<Ts...>();
+		boost::dynamic_bitset<> excluded = ExcludedSignature<Ts...>();
+		std::vector<int> candidates;
+		bool found = false;
+		(FilterCandidates<Ts>(candidates, found), ...);
+		std::vector<Object> result;
+		for (int o : candidates) {
+			if ((sig & objectSignatures[o]) == sig && !excluded.intersects(objectSignatures[o]) && (PassesFilter<Ts>(o) && ...)) {
+				result.push_back(ConstructObject(o));
+			}
+		}
+		return result;
+	}
+	// Collect the objects logged by the first filter in the query
+	template<class T> void FilterCandidates(std::vector<int>& candidates, bool& found) {
+		if constexpr (QueryTerm<T>::filter) {
+			if (found) {
+				return;
+			}
+			found = true;
+			auto array = GetComponentArray<typename QueryTerm<T>::Component>();
+			auto& log = array->Changes(QueryTerm<T>::added);
+			auto it = std::upper_bound(log.begin(), log.end(), std::make_pair(queryTick, INT_MAX));
+			for (; it != log.end(); it++) {
+				// Only take the latest entry for each object so it is listed once
+				if (array->ChangedSince(it->second, it->first - 1, QueryTerm<T>::added) &&
+					!array->ChangedSince(it->second, it->first, QueryTerm<T>::added)) {
+					candidates.push_back(it->second);
+				}
+			}
+		}
+	}
+	template<class T> bool PassesFilter(int o) {
+		if constexpr (QueryTerm<T>::filter) {
+			return GetComponentArray<typename QueryTerm<T>::Component>()->ChangedSince(o, queryTick, QueryTerm<T>::added);
+		}
+		else {
+			return true;
+		}
+	}
+
+	template <class T> ComponentObservers<T>& GetObservers() {
+		auto& observer = observers[GetCompID<T>()];
+		if (!observer) {
+			observer = std::make_shared<ComponentObservers<T>>();
+		}
+		return *std::static_pointer_cast<ComponentObservers<T>>(observer);
+	}
+	template <class T> Events<T>& GetEvents() {
+		auto& channel = channels[typeid(T).name()];
+		if (!channel) {
+			channel = std::make_shared<Events<T>>();
+		}
+		return *std::static_pointer_cast<Events<T>>(channel);
+	}
+	void NotifyAdded(int c, int o) {
+		auto it = observers.find(c);
+		if (it != observers.end()) {
+			it->second->Added(o);
+		}
+	}
+	void NotifyRemoved(int c, int o) {
+		auto it = observers.find(c);
+		if (it != observers.end()) {
+			it->second->Removed(o, compArrays);
+		}
+	}
+
+	// Visit each group that mentions at least one of the object's components, once per group
+	template <class F> void ForEachCandidateGroup(int o, F visit) {
+		auto& sig = objectSignatures[o];
+		for (int c = sig.find_first(); c != sig.npos && c < compGroups.size(); c = sig.find_next(c)) {
+			for (int g : compGroups[c]) {
+				// A group is visited through its lowest component only
+				if (groupSigs[g].find_first() == c) {
+					visit(g);
+				}
+			}
+		}
+	}
+
+	void AddToGroups(int o) {
+		ForEachCandidateGroup(o, [this, o](int g) {
+			if (ObjInGroup(o, g)) {
+				groups[g].insert(ConstructObject(o));
+			}
+		});
+	}
+
+	void RemoveFromGroups(int o) {
+		ForEachCandidateGroup(o, [this, o](int g) {
+			if (ObjInGroup(o, g)) {
+				groups[g].erase(ConstructObject(o));
+			}
+		});
+	}
+
+	// Add or remove an object from the groups that mention component c after the component is
+	// added or before it is removed. Groups that exclude c change the other way around.
+	void UpdateGroups(int o, int c, bool added) {
+		if (c >= compGroups.size()) {
+			return;
+		}
+		for (int g : compGroups[c]) {
+			bool excluded = groupExcludes[g][c];
+			// The signature holds c either way, so check an excluding group as if c were missing
+			bool matches = excluded ? (groupSigs[g] & objectSignatures[o]) == groupSigs[g] &&
+				(groupExcludes[g] & objectSignatures[o]).count() == 1 : ObjInGroup(o, g);
+			if (matches) {
+				if (added != excluded) {
+					groups[g].insert(ConstructObject(o));
+				}
+				else {
+					groups[g].erase(ConstructObject(o));
+				}
+			}
+		}
+	}
+
+	// Measure part of the game data and raise its high-water mark if needed. The names are
+	// filled in by MemoryReport, so that sampling every frame doesn't build strings.
+	MemoryStats ObjectMemory() {
+		MemoryStats stats;
+		stats.capacity = objectSignatures.size();
+		stats.free = availableObjIDs.size();
+		stats.live = stats.capacity - stats.free;
+		stats.bytes = objectSignatures.capacity() * sizeof(boost::dynamic_bitset<>) + objectGenerations.capacity() * sizeof(long long) +
+			availableObjIDs.size() * sizeof(int) +
+			signatureBlocks * sizeof(boost::dynamic_bitset<>::block_type);
+		return Peak(stats, objectPeak);
+	}
+	// Replace an object's signature, keeping the count of signature blocks up to date so that
+	// measuring the object table doesn't have to visit every object
+	void SetSignature(int o, const boost::dynamic_bitset<>& signature) {
+		signatureBlocks -= objectSignatures[o].num_blocks();
+		objectSignatures[o] = signature;
+		signatureBlocks += signature.num_blocks();
+	}
+	MemoryStats ArrayMemory(int c) {
+		arrayPeaks.resize(compArrays.NumberComponents());
+		return Peak(GetComponentArray(c)->Memory(), arrayPeaks[c]);
+	}
+	MemoryStats GroupMemory(int g) {
+		MemoryStats stats;
+		stats.live = stats.capacity = groups[g].size();
+		stats.bytes = SetBytes(groups[g]);
+		groupPeaks.resize(groups.size());
+		return Peak(stats, groupPeaks[g]);
+	}
+	MemoryStats TagMemory(const std::string& tag) {
+		MemoryStats stats;
+		stats.live = stats.capacity = tags[tag].size();
+		stats.bytes = SetBytes(tags[tag]);
+		return Peak(stats, tagPeaks[tag]);
+	}
+	static MemoryStats Peak(MemoryStats stats, size_t& peak) {
+		peak = std::max(peak, stats.bytes);
+		stats.peakBytes = peak;
+		return stats;
+	}
+	// Each node of a set holds the object, three links, and a color
+	static size_t SetBytes(const ObjectSet& set) {
+		return sizeof(ObjectSet) + set.size() * (sizeof(Object) + 4 * sizeof(void*));
+	}
+
 	Object ConstructObject(int id) {
 		Object o = Object();
 		o.id = id;
 		o.compArrays = &compArrays;
+		o.gameData = this;
 		return o;
 	}
 
@@ -303,27 +1334,107 @@ private:
 		return GetSignature<Ts...>(sig);
 	}
 
+	// The components a query requires, and the ones its Without terms exclude
+	template<class...Ts> boost::dynamic_bitset<> QuerySignature() {
+		boost::dynamic_bitset<> sig(compArrays.NumberComponents());
+		([&] {
+			if constexpr (QueryTerm<Ts>::required) {
+				sig.set(GetCompID<typename QueryTerm<Ts>::Component>());
+			}
+		}(), ...);
+		return sig;
+	}
+	template<class...Ts> boost::dynamic_bitset<> ExcludedSignature() {
+		boost::dynamic_bitset<> sig(compArrays.NumberComponents());
+		(SetExcluded(sig, (Ts*)nullptr), ...);
+		return sig;
+	}
+	template<class T> void SetExcluded(boost::dynamic_bitset<>&, T*) {}
+	template<class...Ts> void SetExcluded(boost::dynamic_bitset<>& sig, Without<Ts...>*) {
+		(sig.set(GetCompID<Ts>()), ...);
+	}
+	// Groups are looked up by their required components, followed by their excluded ones if they have any
+	static boost::dynamic_bitset<> GroupKey(const boost::dynamic_bitset<>& sig, const boost::dynamic_bitset<>& excluded) {
+		if (excluded.none()) {
+			return sig;
+		}
+		boost::dynamic_bitset<> key = sig;
+		key.resize(sig.size() + excluded.size());
+		for (int c = excluded.find_first(); c != excluded.npos; c = excluded.find_next(c)) {
+			key.set(sig.size() + c);
+		}
+		return key;
+	}
+
 	//Singletons
 	std::unordered_map<const char*, std::shared_ptr<Singleton>> singletons;
+	std::unordered_map<const char*, int> singletonGenerations;
+	std::unordered_map<const char*, std::shared_ptr<IEventChannel>> channels;
 	std::shared_ptr<std::unordered_map<const char*, std::shared_ptr<Singleton>>> persistentSingletons;
 	//Components
 	CompArrays compArrays;
 	//Objects
-	std::queue<int> availableObjIDs;
+	std::deque<int> availableObjIDs;
 	std::vector<boost::dynamic_bitset<>> objectSignatures;
+	std::vector<long long> objectGenerations;	// Changes whenever an ID starts or stops being a live object, 0 while it is free
+	long long nextGeneration = 0;	// Never rewound, so objects recreated by resimulating get new generations
+	size_t signatureBlocks = 0;	// Blocks held by all of the signatures together
 	std::unordered_map<std::string, boost::dynamic_bitset<>> objectDefinitions;
 	//Groups
 	std::vector<boost::dynamic_bitset<>> groupSigs;
+	std::vector<boost::dynamic_bitset<>> groupExcludes;	// The components that keep objects out of each group
 	std::unordered_map<boost::dynamic_bitset<>, int> groupIDs;
 	int nextGroupID = 0;
 	std::unordered_map<boost::dynamic_bitset<>, bool> groupInit;
-	std::vector<std::set<Object>> groups;
+	std::vector<ObjectSet> groups;
+	std::vector<std::vector<int>> compGroups;	// The groups each component appears in
 	//Tags
-	std::unordered_map<std::string, std::set<Object>> tags;
+	std::unordered_map<std::string, ObjectSet> tags;
+	//Observers
+	std::unordered_map<int, std::shared_ptr<IComponentObservers>> observers;
+	//Rollback
+	RollbackBuffer rollback;
+	//Change detection
+	int changeTick = 0;
+	int queryTick = -1;
+	//Compaction
+	static const int COMPACTION_STEP = 256;	// Components visited between checks of the time budget
+	double compactionBudget = 0;
+	bool compactByObject = true;
+	//Memory accounting
+	size_t objectPeak = 0;
+	std::vector<size_t> arrayPeaks;
+	std::vector<size_t> groupPeaks;
+	std::unordered_map<std::string, size_t> tagPeaks;
+	AllocationTotals allocationsCounted;	// Made by the scene so far
+	AllocationTotals allocationsSampled;	// Already reported to the profiler
+	AllocationTotals countingMark;	// The thread's totals when counting last started or sampled
+	int countingDepth = 0;
 
 	friend class Game;
 };
 
+template <class T> T& Object::AddComponent() {
+	return gameData->AddComponent<T>(*this);
+}
+template <class T> void Object::SetComponent(T value) {
+	gameData->SetComponent<T>(*this, std::move(value));
+}
+template <class T> void Object::RemoveComponent() {
+	gameData->RemoveComponent<T>(*this);
+}
+template <class T> bool Object::HasComponent() {
+	return gameData->HasComponent<T>(*this);
+}
+
+template <class T> T* Object::TryGetComponent() {
+	return HasComponent<T>() ? &GetComponent<T>() : nullptr;
+}
+
+template <class T> const T* Object::TryReadComponent() const {
+	return gameData->HasComponent<T>(*this) ? &ReadComponent<T>() : nullptr;
+}
+
 // Forward-declare the GInterface class so it can reference pointers to itself
 class GInterface;
 
@@ -345,6 +1456,7 @@ public:
 
 private:
 	std::unordered_map<const char*, std::shared_ptr<GInterface>> interfaces;
+	friend class Scene;
 };
 
 // Interface Class:
@@ -363,11 +1475,36 @@ protected:
 		deleteQueue.insert(o);
 	}
 
+	// Hold on to an object across frames, e.g. in a task, and get it back if it still exists
+	ObjectHandle Handle(Object o) {
+		return gdata->Handle(o);
+	}
+	std::optional<Object> Resolve(ObjectHandle handle) {
+		return gdata->Resolve(handle);
+	}
+
+	// Additions and removals are applied after the system finishes, in the order they were made
+	// and before DestroyObject's, so that the groups being iterated aren't changed underneath it.
+	// The component returned by AddComponent is staged until then, and can be filled in meanwhile.
+	template <class T> T& AddComponent(Object o) {
+		auto staged = std::make_shared<T>();
+		GameData* data = gdata;
+		componentQueue.push_back([data, o, staged] { data->AddComponent<T>(o) = std::move(*staged); });
+		return *staged;
+	}
+	template <class T> void SetComponent(Object o, T value) {
+		gdata->SetComponent<T>(o, std::move(value));
+	}
+	template <class T> void RemoveComponent(Object o) {
+		GameData* data = gdata;
+		componentQueue.push_back([data, o] { data->RemoveComponent<T>(o); });
+	}
+
 	template <class T> T& GetInterface() {
 		return interfaces->GetInterface<T>();
 	}
 
-	template<class ...Ts> std::set<Object>& ObjectsWith() {
+	template<class ...Ts> decltype(auto) ObjectsWith() {
 		return gdata->ObjectsWith<Ts...>();
 	}
 
@@ -384,11 +1521,70 @@ protected:
 	void SwitchScene(std::string scene) {
 		gdata->eventInterface.SwitchScene(scene);
 	}
+	void PreloadScene(std::string scene) {
+		gdata->eventInterface.PreloadScene(scene);
+	}
+
+	// Hand a coroutine to the scene's scheduler, running it up to its first co_await. Tasks are
+	// resumed after the default systems each frame, and their deferred changes are applied then.
+	void StartTask(Task task) {
+		gdata->StartTask(std::move(task));
+	}
+
+	// Schedule a callback, or just a deadline to check with TimerPending, the given number of
+	// frames ahead. Callbacks run after the default systems, like tasks.
+	TimerHandle ScheduleTimer(long long frames, std::function<void()> callback = {}) {
+		return gdata->ScheduleTimer(frames, std::move(callback));
+	}
+	bool CancelTimer(TimerHandle timer) {
+		return gdata->CancelTimer(timer);
+	}
+	bool TimerPending(TimerHandle timer) {
+		return gdata->TimerPending(timer);
+	}
+	long long TimerRemaining(TimerHandle timer) {
+		return gdata->TimerRemaining(timer);
+	}
+	// Number of frames the scene has finished. It goes up at the end of each frame, just before
+	// the timers due on the new count fire.
+	long long FrameCount() {
+		return gdata->FrameCount();
+	}
+
+	// Send an event to the systems that read its type. Events are read during the next frame,
+	// so a producer doesn't depend on which systems consume its events or in what order.
+	template <class T> void SendEvent(T event) {
+		gdata->SendEvent<T>(std::move(event));
+	}
+	// The events of type T sent during the previous frame, as one contiguous batch
+	template <class T> std::span<const T> ReadEvents() {
+		return gdata->ReadEvents<T>();
+	}
+
+	// Rewind the game by the given number of frames once the current frame ends,
+	// optionally resimulating back up to the present
+	void Rollback(int frames, bool resimulate = false) {
+		gdata->rollbackRequest = { frames,resimulate };
+	}
+	bool IsResimulating() {
+		return gdata->resimulating;
+	}
+
+	// Get the profiler used to report per-frame measurements
+	Profiler& GetProfiler() {
+		return gdata->profiler;
+	}
+
+	// Get the memory use of the object table and every component array, group, and tag
+	std::vector<MemoryStats> MemoryReport() {
+		return gdata->MemoryReport();
+	}
 
 private:
 	GameData* gdata;
 	InterfaceStorer* interfaces;
 	std::set<Object> deleteQueue;
+	std::vector<std::function<void()>> componentQueue;
 	friend class InterfaceStorer;
 	friend class System;
 	friend class Scene;
@@ -397,6 +1593,9 @@ private:
 // System Class:
 // A class with single update function that can be called to update the game state in a 
 // particular way. To be derived by the user and registered in a scene.
+// Work that doesn't need to finish every frame can be spread out: a system can run only every
+// few frames, and can set a time budget that its walks over queries stop at, resuming from the
+// same place on its next run.
 class System : public GInterface {
 public:
 	virtual void Update() {};
@@ -405,6 +1604,50 @@ public:
 	};
 
 protected:
+	// Only run the system every given number of frames. Systems with the same period are spread
+	// over different frames by the order they were registered in, so their work doesn't pile up.
+	void RunEvery(int frames) {
+		period = std::max(1, frames);
+	}
+	// Limit the milliseconds the system spends each frame. Resume stops once the budget is spent,
+	// and a run that goes over it anyway is paid back by skipping the system's next runs. Which
+	// frames the work lands on then depends on timing, so budgets are for work that may lag
+	// behind without changing the outcome of the game.
+	void SetBudget(double milliseconds) {
+		budget = milliseconds;
+	}
+	// Whether the current run has spent the system's budget, for work that isn't a walk over a query
+	bool OverBudget() {
+		return budget > 0 && Profiler::Since(runStart) >= budget;
+	}
+
+	// Visit the objects of a query in order, starting after the last object visited by the
+	// previous run. Each run visits enough objects for the whole query to be covered every given
+	// number of runs, or fewer if the budget runs out. Returns whether the end was reached, in
+	// which case the next run starts over from the beginning. A system has one cursor, so it
+	// should resume a single query.
+	template <class F> bool Resume(const ObjectSet& objects, int runs, F&& visit) {
+		auto it = cursor ? objects.upper_bound(*cursor) : objects.begin();
+		int share = (objects.size() + runs - 1) / runs;
+		for (int visited = 0; it != objects.end() && visited < share; visited++) {
+			// Always make some progress, and only check the clock now and then
+			if (visited > 0 && visited % BUDGET_CHECK == 0 && OverBudget()) {
+				break;
+			}
+			cursor = *it;
+			++it;
+			visit(*cursor);
+		}
+		if (it == objects.end()) {
+			cursor.reset();
+			return true;
+		}
+		return false;
+	}
+	template <class F> bool Resume(const ObjectSet& objects, F&& visit) {
+		return Resume(objects, 1, std::forward<F>(visit));
+	}
+
 	template <class T> T& GetInterface() {
 		return interfaces->GetInterface<T>();
 	}
@@ -415,12 +1658,29 @@ protected:
 
 	using GInterface::ObjectsWith;
 
-	std::set<Object> ObjectsWith(std::string tag) {
+	// The objects with a tag, which changes as soon as objects are given the tag, unlike groups
+	const ObjectSet& ObjectsWith(std::string tag) {
 		return gdata->ObjectsWith(tag);
 	}
 
+	// The name of the system as reported to the profiler
+	const std::string& Name() {
+		return name;
+	}
+
 private:
+	static const int BUDGET_CHECK = 16;	// Objects visited by Resume between checks of the budget
+
 	InterfaceStorer* interfaces;
+	int lastRunTick = -1;
+	std::string name;
+	int profileKey = -1;	// The profiler's key for the system's time, for default systems
+	int period = 1;
+	int phase = 0;	// Offset of the frames the system runs on, within its period
+	double budget = 0;	// No limit if 0
+	double debt = 0;	// Milliseconds spent over the budget that haven't been paid back yet
+	std::chrono::steady_clock::time_point runStart;
+	std::optional<Object> cursor;	// The last object visited by Resume
 	friend class Scene;
 };
 
@@ -429,28 +1689,118 @@ private:
 // A game can consist of multiple scenes that are switched between.
 class Scene {
 public:
+	// Systems registered in this batch run on the main thread while the default systems run on
+	// a simulation thread, such as rendering and presenting the frames the simulation publishes.
+	// They must only use persistent singletons and the data handed to them, never the scene's
+	// objects, singletons, or profiler.
+	static inline const std::string PRESENT_BATCH = "present";
+
 	virtual void Start() {
+		if (!loaded) {
+			Load();
+		}
+		if (systems.count(PRESENT_BATCH)) {
+			RunPipelined();
+		}
+		else {
+			bool quit = false;
+			while (!quit) {
+				quit = Step();
+			}
+		}
+		Quit();
+	}
+
+	// Register everything and create the initial objects without starting the scene. This
+	// only touches the scene's own data, so it can run on a worker thread.
+	void Load() {
+		gameData.StartCounting();
 		Init();
-		bool quit = false;
-		while (!quit) {
-			for (int i = 0; i < defaultSystems.size(); i++) {
-				defaultSystems[i]->Update();
-				while (!defaultSystems[i]->deleteQueue.empty()) {
-					gameData.DestroyObject(*(defaultSystems[i]->deleteQueue.begin()));
-					defaultSystems[i]->deleteQueue.erase(defaultSystems[i]->deleteQueue.begin());
-				}
+		gameData.StopCounting();
+		loaded = true;
+	}
+
+	// Run the default systems for a single frame, returning whether the scene should end
+	bool Step() {
+		auto frameStart = std::chrono::steady_clock::now();
+		gameData.StartCounting();
+		int deferred = 0;
+		for (int i = 0; i < defaultSystems.size(); i++) {
+			System& system = *defaultSystems[i];
+			if (!Due(system)) {
+				deferred++;
+				continue;
 			}
-			if (gameData.eventInterface.ShouldQuit() || gameData.eventInterface.ShouldSwitchScene().first) {
-				quit = true;
+			auto start = std::chrono::steady_clock::now();
+			system.runStart = start;
+			system.lastRunTick = gameData.BeginSystem(system.lastRunTick);
+			system.Update();
+			ApplyQueues(system);
+			double elapsed = Profiler::Since(start);
+			gameData.profiler.Add(system.profileKey, elapsed);
+			if (system.budget > 0) {
+				system.debt = std::max(0.0, system.debt + elapsed - system.budget);
 			}
 		}
-		Quit();
+		gameData.profiler.Count("systems.deferred", deferred);
+		RunScheduled();
+		gameData.profiler.Count("events", gameData.SwapEvents());
+		gameData.RunCompaction();
+		gameData.SampleMemory();
+		gameData.profiler.Count("frame", Profiler::Since(frameStart));
+		gameData.profiler.EndFrame();
+		gameData.CommitFrame();
+		gameData.TrimChanges(OldestRunTick());
+		if (gameData.rollbackRequest.first > 0) {
+			auto request = gameData.rollbackRequest;
+			gameData.rollbackRequest = { 0,false };
+			int frames = Rewind(request.first);
+			if (request.second) {
+				Resimulate(frames);
+			}
+		}
+		gameData.StopCounting();
+		return gameData.eventInterface.ShouldQuit() || gameData.eventInterface.ShouldSwitchScene().first;
+	}
+
+	// Restore the scene to how it was the given number of frames ago. Returns the number of
+	// frames actually rewound, which is limited by the rollback buffer's size.
+	int Rewind(int frames) {
+		return gameData.Rewind(frames);
+	}
+
+	// Run the default systems again for the given number of frames, e.g. after a rewind
+	// with corrected input. Systems can check IsResimulating() to skip presentation.
+	void Resimulate(int frames) {
+		gameData.resimulating = true;
+		for (int i = 0; i < frames; i++) {
+			Step();
+		}
+		gameData.resimulating = false;
+	}
+
+	// Simulate on a separate thread while the main thread keeps running the present batch, so
+	// that presenting one frame overlaps simulating the next
+	void RunPipelined() {
+		std::atomic<bool> done = false;
+		std::thread simulation([this, &done] {
+			while (!Step()) {}
+			done = true;
+		});
+		while (!done) {
+			for (auto& system : systems[PRESENT_BATCH]) {
+				system->Update();
+			}
+		}
+		simulation.join();
 	}
 
 	bool RunBatch(std::string batch) {
 		bool quit = false;
 		for (int i = 0; i < systems[batch].size(); i++) {
+			systems[batch][i]->lastRunTick = gameData.BeginSystem(systems[batch][i]->lastRunTick);
 			systems[batch][i]->Update();
+			ApplyQueues(*systems[batch][i]);
 		}
 		if (gameData.eventInterface.ShouldQuit() || gameData.eventInterface.ShouldSwitchScene().first) {
 			quit = true;
@@ -461,7 +1811,9 @@ public:
 	bool RunBatch(std::string batch, float dt) {
 		bool quit = false;
 		for (int i = 0; i < systems[batch].size(); i++) {
+			systems[batch][i]->lastRunTick = gameData.BeginSystem(systems[batch][i]->lastRunTick);
 			systems[batch][i]->Update(dt);
+			ApplyQueues(*systems[batch][i]);
 		}
 		if (gameData.eventInterface.ShouldQuit() || gameData.eventInterface.ShouldSwitchScene().first) {
 			quit = true;
@@ -488,6 +1840,31 @@ protected:
 		gameData.RegisterComponent<Ts...>();
 	}
 
+	void EnableRollback(int frames) {
+		gameData.EnableRollback(frames);
+	}
+
+	void EnableCompaction(double milliseconds, bool byObject = true) {
+		gameData.EnableCompaction(milliseconds, byObject);
+	}
+
+	// Start a coroutine from the scene, e.g. a script that runs from the first frame
+	void StartTask(Task task) {
+		gameData.StartTask(std::move(task));
+	}
+	// Set how many frames make up a second for tasks waiting on Seconds
+	void SetTickRate(int ticksPerSecond) {
+		gameData.tasks.SetTickRate(ticksPerSecond);
+	}
+
+	Profiler& GetProfiler() {
+		return gameData.profiler;
+	}
+
+	std::vector<MemoryStats> MemoryReport() {
+		return gameData.MemoryReport();
+	}
+
 	template <class T> void CreateSingleton() {
 		gameData.CreateSingletons<T>();
 	}
@@ -509,9 +1886,12 @@ protected:
 	template<class...Ts> typename std::enable_if<sizeof...(Ts) == 0>::type RegisterSystems(std::string batch) {}
 	template<class T, class...Ts> void RegisterSystems(std::string batch = "") {
 		auto sys = std::make_shared<T>();
+		sys->name = TypeName<T>();
 		sys->gdata = &gameData;
 		sys->interfaces = &interfaces;
 		if (batch == "") {
+			sys->phase = defaultSystems.size();
+			sys->profileKey = gameData.profiler.Key("system." + sys->name);
 			defaultSystems.push_back(sys);
 		}
 		else {
@@ -524,6 +1904,16 @@ protected:
 		gameData.DefineObject<Ts...>(name);
 	}
 
+	template <class T> void OnAdd(typename ComponentObservers<T>::ObjectCallback callback) {
+		gameData.OnAdd<T>(callback);
+	}
+	template <class T> void OnSet(typename ComponentObservers<T>::ObjectCallback callback) {
+		gameData.OnSet<T>(callback);
+	}
+	template <class T> void OnRemove(typename ComponentObservers<T>::RemoveCallback callback) {
+		gameData.OnRemove<T>(callback);
+	}
+
 	Object CreateObject(std::string name) {
 		return gameData.CreateObject(name);
 	}
@@ -532,18 +1922,114 @@ protected:
 		gameData.AddTag(o, tag);
 	}
 
-	void Reset() {
+	bool CancelTimer(TimerHandle timer) {
+		return gameData.CancelTimer(timer);
+	}
+
+	// Clear the scene so it can be started again. The old state is returned rather than freed
+	// so that the caller can choose where to tear it down.
+	std::shared_ptr<void> Reset() {
+		auto old = std::make_shared<SceneState>();
+		old->systems = std::move(systems);
+		old->defaultSystems = std::move(defaultSystems);
+		old->interfaces = std::move(interfaces);
+		old->gameData = std::move(gameData);
 		systems = std::unordered_map<std::string, std::vector<std::shared_ptr<System>>>();
 		defaultSystems = std::vector<std::shared_ptr<System>>();
 		interfaces = InterfaceStorer();
 		gameData = GameData();
+		taskRunTick = -1;
+		loaded = false;
+		return old;
 	}
 
 private:
+	// Whether a default system runs this frame: on the frames of its period, once it has paid back
+	// any time it spent over its budget. A skipped system keeps its last run tick, so it still
+	// sees the changes made while it was skipped.
+	bool Due(System& system) {
+		if ((gameData.FrameCount() + system.phase) % system.period != 0) {
+			return false;
+		}
+		if (system.debt > 0) {
+			system.debt = std::max(0.0, system.debt - system.budget);
+			return false;
+		}
+		return true;
+	}
+
+	// Fire the timers and resume the tasks that are due this frame. They make their changes through
+	// whichever system or interface scheduled them, so all of their deferred changes are applied afterwards.
+	void RunScheduled() {
+		auto start = std::chrono::steady_clock::now();
+		taskRunTick = gameData.BeginSystem(taskRunTick);
+		int fired = gameData.AdvanceTimers();
+		if (gameData.tasks.Run() + fired > 0) {
+			for (auto& system : defaultSystems) {
+				ApplyQueues(*system);
+			}
+			for (auto& batch : systems) {
+				if (batch.first == PRESENT_BATCH) {
+					continue;
+				}
+				for (auto& system : batch.second) {
+					ApplyQueues(*system);
+				}
+			}
+			for (auto& i : interfaces.interfaces) {
+				ApplyQueues(*i.second);
+			}
+		}
+		gameData.profiler.Count("tasks", Profiler::Since(start));
+		gameData.profiler.Count("tasks.suspended", gameData.tasks.Size());
+		gameData.profiler.Count("timers.fired", fired);
+		gameData.profiler.Count("timers.pending", gameData.timers.Size());
+	}
+
+	// Apply the structural changes a system or interface deferred until the end of its update
+	void ApplyQueues(GInterface& system) {
+		for (auto& change : system.componentQueue) {
+			change();
+		}
+		system.componentQueue.clear();
+		while (!system.deleteQueue.empty()) {
+			gameData.DestroyObject(*(system.deleteQueue.begin()));
+			system.deleteQueue.erase(system.deleteQueue.begin());
+		}
+		gameData.FlushObservers();
+	}
+
+	// The earliest tick any system last ran at. Changes made before it can't be seen anymore.
+	int OldestRunTick() {
+		int tick = taskRunTick;
+		for (auto& system : defaultSystems) {
+			tick = std::min(tick, system->lastRunTick);
+		}
+		for (auto& batch : systems) {
+			// Present systems don't read the scene's objects, so they don't hold changes back
+			if (batch.first == PRESENT_BATCH) {
+				continue;
+			}
+			for (auto& system : batch.second) {
+				tick = std::min(tick, system->lastRunTick);
+			}
+		}
+		return tick;
+	}
+
+	struct SceneState {
+		std::unordered_map<std::string, std::vector<std::shared_ptr<System>>> systems;
+		std::vector<std::shared_ptr<System>> defaultSystems;
+		InterfaceStorer interfaces;
+		GameData gameData;
+	};
+
 	std::unordered_map<std::string, std::vector<std::shared_ptr<System>>> systems;
 	std::vector<std::shared_ptr<System>> defaultSystems;
 	InterfaceStorer interfaces;
 	GameData gameData;
+	int taskRunTick = -1;
+	bool loaded = false;
 
 	friend class Game;
 };
@@ -560,16 +2046,47 @@ public:
 	void Start(std::string _scene) {
 		scene = _scene;
 		Init();
-		scenes[scene]->Start();
+		StartScene(scene);
 		while (!scenes[scene]->gameData.eventInterface.ShouldQuit() && scenes[scene]->gameData.eventInterface.ShouldSwitchScene().first) {
-			scenes[scene]->gameData.eventInterface.Reset();
-			std::string temp = scene;
-			scene = scenes[scene]->gameData.eventInterface.ShouldSwitchScene().second;
-			scenes[temp]->Reset();
-			scenes[temp]->gameData.persistentSingletons = persistentSingletons;
-			scenes[scene]->Start();
+			NextScene();
+			StartScene(scene);
+		}
+		Quit();
+	}
+
+	// Set the game up to be advanced one frame at a time with Step instead of running it with
+	// Start, e.g. by a WorldRunner. Present batches aren't run in this mode.
+	void Begin(std::string _scene) {
+		scene = _scene;
+		Init();
+		LoadScene(scene);
+	}
+
+	// Run a single frame of the current scene, switching scenes when it asks to. Returns whether
+	// the game has ended. A game holds no state outside of its own scenes and persistent
+	// singletons, so separate games can be stepped on separate threads.
+	bool Step() {
+		if (!scenes[scene]->Step()) {
+			return false;
+		}
+		scenes[scene]->Quit();
+		if (!scenes[scene]->gameData.eventInterface.ShouldQuit() && scenes[scene]->gameData.eventInterface.ShouldSwitchScene().first) {
+			NextScene();
+			LoadScene(scene);
+			return false;
 		}
 		Quit();
+		return true;
+	}
+
+	// Build the given scene on the background thread while the current scene keeps running.
+	// The running scene can't be preloaded, so switching to itself still loads in place.
+	void PreloadScene(std::string name) {
+		if (name == scene || !scenes.count(name) || preloads.count(name) || scenes[name]->loaded) {
+			return;
+		}
+		auto next = scenes[name];
+		preloads[name] = background.Submit([next] { next->Load(); });
 	}
 protected:
 	virtual void Init() = 0;
@@ -594,7 +2111,37 @@ protected:
 	}
 
 private:
+	void StartScene(std::string name) {
+		LoadScene(name);
+		scenes[name]->Start();
+	}
+
+	void LoadScene(std::string name) {
+		// Wait for a preload of the scene to finish before it is swapped in
+		if (preloads.count(name)) {
+			preloads[name].get();
+			preloads.erase(name);
+		}
+		scenes[name]->gameData.eventInterface.preloadScene = [this](std::string next) { PreloadScene(next); };
+		if (!scenes[name]->loaded) {
+			scenes[name]->Load();
+		}
+	}
+
+	// Move on to the scene the current one switched to
+	void NextScene() {
+		scenes[scene]->gameData.eventInterface.Reset();
+		std::string temp = scene;
+		scene = scenes[scene]->gameData.eventInterface.ShouldSwitchScene().second;
+		// Free the old scene's objects on the background thread instead of during the switch
+		auto old = scenes[temp]->Reset();
+		background.Submit([old = std::move(old)]() mutable { old.reset(); });
+		scenes[temp]->gameData.persistentSingletons = persistentSingletons;
+	}
+
 	std::shared_ptr<std::unordered_map<const char*, std::shared_ptr<Singleton>>> persistentSingletons;
 	std::unordered_map<std::string, std::shared_ptr<Scene>> scenes;
+	std::unordered_map<std::string, std::future<void>> preloads;
 	std::string scene;
+	ThreadPool background = ThreadPool(1);
 };
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include "Rollback.h"
+#include <vector>
+#include <span>
+#include <utility>
+
+// Base class so that channels of every event type can be swapped together
+class IEventChannel {
+public:
+	virtual ~IEventChannel() = default;
+	// Make the events sent this frame readable and start an empty frame, returning how many were sent
+	virtual int Swap(RollbackBuffer& rollback) = 0;
+};
+
+// Events Class:
+// A double-buffered channel of one event type, such as collisions found by one system and handled
+// by others. Producers append to the frame's buffer without touching anything else, and once the
+// frame ends the buffers are swapped, so consumers read the whole previous frame's events as one
+// contiguous batch in the order they were sent. Both buffers are kept in the rollback journal.
+template <class T> class Events : public IEventChannel {
+public:
+	void Send(T event, RollbackBuffer& rollback) {
+		// Remember how many events there were before the first one sent this frame
+		if (rollback.Recording() && generation != rollback.Generation()) {
+			generation = rollback.Generation();
+			rollback.Record([this, size = writing.size()] { writing.erase(writing.begin() + size, writing.end()); });
+		}
+		writing.push_back(std::move(event));
+	}
+
+	// The events sent during the previous frame
+	std::span<const T> Read() const {
+		return reading;
+	}
+
+	int Swap(RollbackBuffer& rollback) override {
+		int sent = writing.size();
+		if (rollback.Recording()) {
+			rollback.Record([this, old = reading] {
+				writing = std::move(reading);
+				reading = old;
+			});
+			reading = std::move(writing);
+			writing = std::vector<T>();
+		}
+		else {
+			// Reuse the old batch's memory for the next frame
+			std::swap(reading, writing);
+			writing.clear();
+		}
+		return sent;
+	}
+
+private:
+	std::vector<T> writing;
+	std::vector<T> reading;
+	int generation = -1;
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstddef>
+
+// MemoryStats Struct:
+// Memory use of one component array, group, or tag, or of the object table. Byte counts are
+// estimates of what the containers hold, including their bookkeeping.
+struct MemoryStats {
+	std::string name;
+	int live = 0;	// Items in use
+	int capacity = 0;	// Items that fit in what is already allocated
+	int free = 0;	// Allocated slots that are waiting to be reused
+	size_t bytes = 0;
+	size_t peakBytes = 0;	// Highest byte count seen at the end of a frame
+
+	static void WriteJSON(std::ostream& out, const std::vector<MemoryStats>& stats) {
+		out << "[";
+		for (int i = 0; i < stats.size(); i++) {
+			out << (i ? "," : "") << "{\"name\":\"" << stats[i].name << "\",\"live\":" << stats[i].live
+				<< ",\"capacity\":" << stats[i].capacity << ",\"free\":" << stats[i].free
+				<< ",\"bytes\":" << stats[i].bytes << ",\"peakBytes\":" << stats[i].peakBytes << "}";
+		}
+		out << "]";
+	}
+};
+
+// Supporting struct for AllocationCounter: the totals at one point in time, or the difference between two
+struct AllocationTotals {
+	long long allocations = 0;
+	long long allocatedBytes = 0;
+	long long freedBytes = 0;
+
+	AllocationTotals operator-(const AllocationTotals& other) const {
+		return { allocations - other.allocations, allocatedBytes - other.allocatedBytes, freedBytes - other.freedBytes };
+	}
+	AllocationTotals& operator+=(const AllocationTotals& other) {
+		allocations += other.allocations;
+		allocatedBytes += other.allocatedBytes;
+		freedBytes += other.freedBytes;
+		return *this;
+	}
+};
+
+// AllocationCounter Class:
+// Totals of the allocations made by the ECS containers on the calling thread. The totals are
+// kept per thread so that worlds stepped in parallel don't contend for them, and a scene takes
+// its own share as the difference across the work it runs on one thread.
+class AllocationCounter {
+public:
+	static void Allocated(size_t bytes) {
+		totals.allocations++;
+		totals.allocatedBytes += bytes;
+	}
+	static void Freed(size_t bytes) {
+		totals.freedBytes += bytes;
+	}
+
+	static AllocationTotals Current() {
+		return totals;
+	}
+
+private:
+	static inline thread_local AllocationTotals totals;
+};
+
+// CountingAllocator Class:
+// The standard allocator, reporting every allocation to the AllocationCounter.
+template <class T> class CountingAllocator {
+public:
+	using value_type = T;
+
+	CountingAllocator() = default;
+	template <class U> CountingAllocator(const CountingAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		AllocationCounter::Allocated(n * sizeof(T));
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T* p, size_t n) {
+		AllocationCounter::Freed(n * sizeof(T));
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template <class U> bool operator==(const CountingAllocator<U>&) const {
+		return true;
+	}
+	template <class U> bool operator!=(const CountingAllocator<U>&) const {
+		return false;
+	}
+};
@@ -0,0 +1,227 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Profiler Class:
+// Collects named per-frame measurements, such as how long each system took or how many objects
+// were culled. Values reported during a frame are summed, and each frame's totals are kept in a
+// rolling window so that recent averages and peaks can be read at runtime or dumped as JSON.
+// Events that aren't tied to one per frame, such as latencies, are sampled into rolling histograms.
+class Profiler {
+public:
+	static const int WINDOW = 120;	// Number of frames kept for each measurement
+	static const int SAMPLES = 1024;	// Number of samples kept for each histogram
+	static const int BUCKETS = 12;	// Histogram buckets, with upper bounds doubling from 0.25 to 256 and a last one for the rest
+
+	// Keys point into the measurements, which moving keeps in place but copying wouldn't
+	Profiler() = default;
+	Profiler(Profiler&&) = default;
+	Profiler& operator=(Profiler&&) = default;
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Set a measurement for the current frame
+	void Count(const std::string& name, double value) {
+		current[name] = value;
+	}
+	// Add to a measurement for the current frame
+	void Add(const std::string& name, double value) {
+		current[name] += value;
+	}
+	// Look a measurement up once, for code that reports it every frame, to be added to by key
+	int Key(const std::string& name) {
+		keyed.push_back({ &series[name] });
+		return keyed.size() - 1;
+	}
+	void Add(int key, double value) {
+		keyed[key].value += value;
+		keyed[key].reported = true;
+	}
+
+	// Close the current frame and add its measurements to the rolling window
+	void EndFrame() {
+		for (auto& measurement : current) {
+			series[measurement.first].Push(measurement.second);
+		}
+		current.clear();
+		for (auto& measurement : keyed) {
+			if (measurement.reported) {
+				measurement.series->Push(measurement.value);
+			}
+			measurement = { measurement.series };
+		}
+		frames++;
+	}
+
+	double Last(const std::string& name) {
+		auto it = series.find(name);
+		return it == series.end() ? 0 : it->second.Last();
+	}
+	double Average(const std::string& name) {
+		auto it = series.find(name);
+		return it == series.end() ? 0 : it->second.Average();
+	}
+	double Max(const std::string& name) {
+		auto it = series.find(name);
+		return it == series.end() ? 0 : it->second.Max();
+	}
+	long long Frames() {
+		return frames;
+	}
+
+	// Add a sample to a histogram, e.g. the latency of a single input
+	void Sample(const std::string& name, double value) {
+		histograms[name].Push(value);
+	}
+	// The value below which the given fraction (0 to 1) of the recent samples fall
+	double Percentile(const std::string& name, double fraction) {
+		auto it = histograms.find(name);
+		return it == histograms.end() ? 0 : it->second.Percentile(fraction);
+	}
+	// The number of recent samples in each bucket
+	std::array<int, BUCKETS> Buckets(const std::string& name) {
+		auto it = histograms.find(name);
+		return it == histograms.end() ? std::array<int, BUCKETS>() : it->second.Buckets();
+	}
+	// Names of all the histograms sampled so far, in sorted order
+	std::vector<std::string> HistogramNames() {
+		std::vector<std::string> names;
+		for (auto& histogram : histograms) {
+			names.push_back(histogram.first);
+		}
+		return names;
+	}
+	// Names of all the measurements reported so far, in sorted order
+	std::vector<std::string> Names() {
+		std::vector<std::string> names;
+		for (auto& measurement : series) {
+			names.push_back(measurement.first);
+		}
+		return names;
+	}
+
+	// Write the last value, average, and peak of every measurement, and the percentiles and buckets
+	// of every histogram, as a JSON object
+	void DumpJSON(std::ostream& out) {
+		out << "{\"frames\":" << frames << ",\"measurements\":{";
+		bool first = true;
+		for (auto& measurement : series) {
+			out << (first ? "" : ",") << "\"" << measurement.first << "\":{\"last\":" << measurement.second.Last()
+				<< ",\"average\":" << measurement.second.Average() << ",\"max\":" << measurement.second.Max() << "}";
+			first = false;
+		}
+		out << "},\"histograms\":{";
+		first = true;
+		for (auto& histogram : histograms) {
+			out << (first ? "" : ",") << "\"" << histogram.first << "\":{\"samples\":" << histogram.second.Count()
+				<< ",\"p50\":" << histogram.second.Percentile(0.5) << ",\"p95\":" << histogram.second.Percentile(0.95)
+				<< ",\"p99\":" << histogram.second.Percentile(0.99) << ",\"max\":" << histogram.second.Percentile(1) << ",\"buckets\":[";
+			auto buckets = histogram.second.Buckets();
+			for (int i = 0; i < BUCKETS; i++) {
+				out << (i ? "," : "") << buckets[i];
+			}
+			out << "]}";
+			first = false;
+		}
+		out << "}}";
+	}
+
+	// Milliseconds elapsed since the given time point, for timing a block of code
+	static double Since(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+private:
+	// Supporting class for a rolling window of one measurement's per-frame values
+	class Series {
+	public:
+		void Push(double value) {
+			if (values.size() < WINDOW) {
+				values.push_back(value);
+			}
+			else {
+				values[next] = value;
+			}
+			last = value;
+			next = (next + 1) % WINDOW;
+		}
+		double Last() const {
+			return last;
+		}
+		double Average() const {
+			double total = 0;
+			for (double value : values) {
+				total += value;
+			}
+			return values.empty() ? 0 : total / values.size();
+		}
+		double Max() const {
+			return values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+		}
+
+	private:
+		std::vector<double> values;
+		int next = 0;
+		double last = 0;
+	};
+
+	// Supporting class for the most recent samples of one histogram
+	class Histogram {
+	public:
+		void Push(double value) {
+			if (values.size() < SAMPLES) {
+				values.push_back(value);
+			}
+			else {
+				values[next] = value;
+			}
+			next = (next + 1) % SAMPLES;
+		}
+		int Count() const {
+			return values.size();
+		}
+		double Percentile(double fraction) const {
+			if (values.empty()) {
+				return 0;
+			}
+			std::vector<double> sorted = values;
+			int rank = std::clamp((int)std::ceil(fraction * sorted.size()) - 1, 0, (int)sorted.size() - 1);
+			std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+			return sorted[rank];
+		}
+		std::array<int, BUCKETS> Buckets() const {
+			std::array<int, BUCKETS> buckets = {};
+			for (double value : values) {
+				int bucket = 0;
+				for (double bound = 0.25; bucket < BUCKETS - 1 && value > bound; bound *= 2) {
+					bucket++;
+				}
+				buckets[bucket]++;
+			}
+			return buckets;
+		}
+
+	private:
+		std::vector<double> values;
+		int next = 0;
+	};
+
+	// Supporting struct for the current frame's value of a measurement reported by key
+	struct Keyed {
+		Series* series;
+		double value = 0;
+		bool reported = false;
+	};
+
+	std::map<std::string, double> current;
+	std::map<std::string, Series> series;
+	std::vector<Keyed> keyed;
+	std::map<std::string, Histogram> histograms;
+	long long frames = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+// RollbackBuffer Class:
+// Keeps the last N frames of a GameData as undo journals. Every structural change records how
+// to reverse itself, and component arrays save a copy of a page only the first time it is
+// written in a frame, so committing a frame costs as much as what changed in it rather than
+// the size of the world.
+class RollbackBuffer {
+public:
+	// Start keeping up to the given number of frames (0 disables recording)
+	void Enable(int _frames) {
+		capacity = _frames;
+		current.clear();
+		frames.clear();
+		generation++;
+	}
+
+	bool Recording() const {
+		return capacity > 0 && !rewinding;
+	}
+
+	int Generation() const {
+		return generation;
+	}
+
+	void Record(std::function<void()> undo) {
+		current.push_back(std::move(undo));
+	}
+
+	// Close the journal of the frame that just finished and start a new one
+	void Commit() {
+		if (capacity <= 0) {
+			return;
+		}
+		frames.push_back(std::move(current));
+		current = std::vector<std::function<void()>>();
+		while ((int)frames.size() > capacity) {
+			frames.pop_front();
+		}
+		generation++;
+	}
+
+	// Undo the uncommitted changes and the last k committed frames, returning the number
+	// of frames actually rewound
+	int Rewind(int k) {
+		rewinding = true;
+		Undo(current);
+		current.clear();
+		k = std::min(k, (int)frames.size());
+		for (int i = 0; i < k; i++) {
+			Undo(frames.back());
+			frames.pop_back();
+		}
+		rewinding = false;
+		generation++;
+		return k;
+	}
+
+	// Number of frames that can currently be rewound
+	int Frames() const {
+		return frames.size();
+	}
+
+	// Number of recorded changes in the frame the given number of frames ago (1 = last frame)
+	int ChangesInFrame(int framesAgo) const {
+		if (framesAgo <= 0 || framesAgo > (int)frames.size()) {
+			return 0;
+		}
+		return frames[frames.size() - framesAgo].size();
+	}
+
+private:
+	static void Undo(std::vector<std::function<void()>>& journal) {
+		for (auto it = journal.rbegin(); it != journal.rend(); it++) {
+			(*it)();
+		}
+	}
+
+	int capacity = 0;
+	int generation = 0;
+	bool rewinding = false;
+	std::vector<std::function<void()>> current;
+	std::deque<std::vector<std::function<void()>>> frames;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+// SPSCRing Class:
+// A fixed-size queue between exactly one producer thread and one consumer thread that never
+// locks. Each side only writes its own index, so pushing and popping are a couple of atomic
+// loads and one store. When the ring is full, pushes fail rather than overwrite unread items.
+template <class T, size_t CAPACITY> class SPSCRing {
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SPSCRing capacity must be a power of two");
+
+public:
+	// Add an item from the producer thread, returning false if the ring is full
+	bool Push(const T& item) {
+		size_t tail = write.load(std::memory_order_relaxed);
+		if (tail - read.load(std::memory_order_acquire) == CAPACITY) {
+			return false;
+		}
+		items[tail & (CAPACITY - 1)] = item;
+		write.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Take the oldest item from the consumer thread, returning false if the ring is empty
+	bool Pop(T& item) {
+		size_t head = read.load(std::memory_order_relaxed);
+		if (head == write.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[head & (CAPACITY - 1)];
+		read.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Number of unread items. Only exact when called from one of the two threads while the
+	// other is idle.
+	size_t Size() const {
+		return write.load(std::memory_order_acquire) - read.load(std::memory_order_acquire);
+	}
+
+private:
+	// The indices only ever increase, and are kept on separate cache lines so the two threads
+	// don't contend over them
+	alignas(64) std::atomic<size_t> write = 0;
+	alignas(64) std::atomic<size_t> read = 0;
+	std::array<T, CAPACITY> items;
+};
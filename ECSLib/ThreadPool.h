@@ -0,0 +1,79 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+// ThreadPool Class:
+// A fixed number of worker threads that run submitted jobs in order. The threads are only
+// started once the first job is submitted, and any queued jobs are finished before the pool
+// is destroyed.
+class ThreadPool {
+public:
+	ThreadPool(int threads = std::thread::hardware_concurrency()) {
+		threadCount = std::max(1, threads);
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	// Queue a job, returning a future for its result
+	template <class F> auto Submit(F job) -> std::future<decltype(job())> {
+		auto task = std::make_shared<std::packaged_task<decltype(job())()>>(std::move(job));
+		auto result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (workers.empty()) {
+				for (int i = 0; i < threadCount; i++) {
+					workers.emplace_back([this] { Work(); });
+				}
+			}
+			jobs.push([task] { (*task)(); });
+		}
+		wake.notify_one();
+		return result;
+	}
+
+	int Size() {
+		return threadCount;
+	}
+
+private:
+	void Work() {
+		while (true) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+				if (jobs.empty()) {
+					return;
+				}
+				job = std::move(jobs.front());
+				jobs.pop();
+			}
+			job();
+		}
+	}
+
+	int threadCount;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable wake;
+};
@@ -0,0 +1,234 @@
+#pragma once
+#include "Rollback.h"
+#include <functional>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <utility>
+
+// Supporting struct identifying a scheduled timer. A default handle refers to no timer, and a
+// handle stops referring to its timer once the timer fires or is cancelled.
+struct TimerHandle {
+	int index = -1;
+	int generation = 0;
+};
+
+// TimerWheel Class:
+// Schedules callbacks a number of ticks ahead. Timers are kept in a hierarchy of wheels of 64 slots,
+// where each level's slots span 64 times as many ticks as the level below, and a slot's timers are
+// moved down a level when the wheel reaches it. Advancing a tick only touches the timers that fire
+// and, once every 64 ticks, the next slot of the level above, so pending timers cost nothing while
+// they wait. Every change is journaled so that the wheel is rewound along with the rest of the game.
+class TimerWheel {
+public:
+	static const int SLOT_BITS = 6;
+	static const int SLOTS = 1 << SLOT_BITS;
+	static const int LEVELS = 4;	// Spans 2^24 ticks, longer timers wait in the top level until in range
+
+	TimerWheel() {
+		heads.fill(-1);
+	}
+	TimerWheel(TimerWheel&&) = default;
+	TimerWheel& operator=(TimerWheel&&) = default;
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	// Call the callback (if any) once the given number of ticks have passed
+	TimerHandle Schedule(long long ticks, std::function<void()> callback, RollbackBuffer& rollback) {
+		int index = Allocate(rollback);
+		Entry& entry = entries[index];
+		entry.due = now + std::max(1LL, ticks);
+		entry.sequence = sequence;
+		entry.callback = std::move(callback);
+		SetSequence(sequence + 1, rollback);
+		Link(index, SlotFor(entry.due), &rollback);
+		return { index, entry.generation };
+	}
+
+	// Stop a timer before it fires, returning whether it was still pending
+	bool Cancel(TimerHandle handle, RollbackBuffer& rollback) {
+		if (!Pending(handle)) {
+			return false;
+		}
+		Unlink(handle.index, &rollback);
+		Free(handle.index, rollback);
+		return true;
+	}
+
+	bool Pending(TimerHandle handle) const {
+		return handle.index >= 0 && handle.index < (int)entries.size() && entries[handle.index].generation == handle.generation
+			&& entries[handle.index].slot >= 0;
+	}
+	// Ticks left until the timer fires, or 0 if it isn't pending
+	long long Remaining(TimerHandle handle) const {
+		return Pending(handle) ? entries[handle.index].due - now : 0;
+	}
+
+	// Move to the next tick and call the callbacks of the timers due on it, in the order they were
+	// scheduled. Returns the number of timers that fired.
+	int Advance(RollbackBuffer& rollback) {
+		SetNow(now + 1, rollback);
+		// Bring the timers of the next slot of each level down once the level below has wrapped around
+		for (int level = 1; level < LEVELS && (now & ((1LL << (SLOT_BITS * level)) - 1)) == 0; level++) {
+			int slot = level * SLOTS + (int)((now >> (SLOT_BITS * level)) & (SLOTS - 1));
+			while (heads[slot] >= 0) {
+				int index = heads[slot];
+				Unlink(index, &rollback);
+				Link(index, SlotFor(entries[index].due), &rollback);
+			}
+		}
+
+		int slot = (int)(now & (SLOTS - 1));
+		firing.clear();
+		for (int index = heads[slot]; index >= 0; index = entries[index].next) {
+			firing.push_back({ entries[index].sequence, { index, entries[index].generation } });
+		}
+		std::sort(firing.begin(), firing.end(), [](auto& a, auto& b) { return a.first < b.first; });
+		int fired = 0;
+		for (auto& timer : firing) {
+			// An earlier callback may have cancelled this one
+			if (!Pending(timer.second)) {
+				continue;
+			}
+			int index = timer.second.index;
+			Unlink(index, &rollback);
+			auto callback = Free(index, rollback);
+			fired++;
+			if (callback) {
+				callback();
+			}
+		}
+		return fired;
+	}
+
+	long long Now() const {
+		return now;
+	}
+	// Number of pending timers
+	int Size() const {
+		return size;
+	}
+
+private:
+	// Supporting struct for a timer, kept in a doubly linked list per slot so it can be cancelled in constant time
+	struct Entry {
+		long long due = 0;
+		long long sequence = 0;
+		std::function<void()> callback;
+		int generation = 0;
+		int slot = -1;	// -1 while the entry is free
+		int prev = -1;
+		int next = -1;
+	};
+
+	int SlotFor(long long dueTick) const {
+		long long delta = dueTick - now;
+		for (int level = 0; level < LEVELS; level++) {
+			if (delta < (1LL << (SLOT_BITS * (level + 1)))) {
+				return level * SLOTS + (int)((dueTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+			}
+		}
+		// Too far ahead: wait in the last slot the top level reaches before wrapping around
+		int top = LEVELS - 1;
+		return top * SLOTS + (int)(((now >> (SLOT_BITS * top)) - 1) & (SLOTS - 1));
+	}
+
+	// Linking and unlinking are undone with each other, passing no rollback buffer so the undo isn't journaled
+	void Link(int index, int slot, RollbackBuffer* rollback) {
+		Entry& entry = entries[index];
+		entry.slot = slot;
+		entry.prev = -1;
+		entry.next = heads[slot];
+		if (heads[slot] >= 0) {
+			entries[heads[slot]].prev = index;
+		}
+		heads[slot] = index;
+		size++;
+		if (rollback && rollback->Recording()) {
+			rollback->Record([this, index] { Unlink(index, nullptr); });
+		}
+	}
+
+	void Unlink(int index, RollbackBuffer* rollback) {
+		Entry& entry = entries[index];
+		int slot = entry.slot;
+		if (entry.prev >= 0) {
+			entries[entry.prev].next = entry.next;
+		}
+		else {
+			heads[slot] = entry.next;
+		}
+		if (entry.next >= 0) {
+			entries[entry.next].prev = entry.prev;
+		}
+		entry.slot = -1;
+		size--;
+		if (rollback && rollback->Recording()) {
+			rollback->Record([this, index, slot] { Link(index, slot, nullptr); });
+		}
+	}
+
+	int Allocate(RollbackBuffer& rollback) {
+		int index;
+		if (freeEntries.empty()) {
+			index = entries.size();
+			entries.emplace_back();
+			if (rollback.Recording()) {
+				rollback.Record([this] { entries.pop_back(); });
+			}
+		}
+		else {
+			index = freeEntries.back();
+			freeEntries.pop_back();
+			// A freed entry keeps its due tick and sequence in case the free is undone as well
+			if (rollback.Recording()) {
+				rollback.Record([this, index, due = entries[index].due, order = entries[index].sequence] {
+					entries[index].due = due;
+					entries[index].sequence = order;
+					entries[index].callback = nullptr;
+					freeEntries.push_back(index);
+				});
+			}
+		}
+		return index;
+	}
+
+	// Release an unlinked entry, handing back its callback
+	std::function<void()> Free(int index, RollbackBuffer& rollback) {
+		Entry& entry = entries[index];
+		auto callback = std::move(entry.callback);
+		entry.callback = nullptr;
+		entry.generation++;
+		freeEntries.push_back(index);
+		if (rollback.Recording()) {
+			rollback.Record([this, index, callback] {
+				freeEntries.pop_back();
+				entries[index].generation--;
+				entries[index].callback = callback;
+			});
+		}
+		return callback;
+	}
+
+	void SetNow(long long tick, RollbackBuffer& rollback) {
+		if (rollback.Recording()) {
+			rollback.Record([this, old = now] { now = old; });
+		}
+		now = tick;
+	}
+
+	void SetSequence(long long next, RollbackBuffer& rollback) {
+		if (rollback.Recording()) {
+			rollback.Record([this, old = sequence] { sequence = old; });
+		}
+		sequence = next;
+	}
+
+	std::vector<Entry> entries;
+	std::vector<int> freeEntries;
+	std::array<int, LEVELS * SLOTS> heads;
+	std::vector<std::pair<long long, TimerHandle>> firing;	// Timers due on the current tick, by sequence
+	long long now = 0;
+	long long sequence = 0;
+	int size = 0;
+};
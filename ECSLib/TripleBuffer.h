@@ -0,0 +1,55 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <utility>
+
+// TripleBuffer Class:
+// Hands frames from one producer thread to one consumer thread. The producer fills the back
+// slot and publishes it, while the consumer keeps using the front slot, so neither waits for
+// the other to finish with its slot. The producer never gets more than one frame ahead: a
+// publish waits until the previously published frame has been taken.
+template <class T> class TripleBuffer {
+public:
+	// The slot being filled by the producer
+	T& Back() {
+		return slots[back];
+	}
+
+	// Make the back slot available to the consumer, waiting while the last published frame
+	// hasn't been taken yet
+	void Publish() {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this] { return !fresh; });
+		std::swap(back, ready);
+		fresh = true;
+		changed.notify_all();
+	}
+
+	// Take the newest published frame, waiting up to the given time for one. Returns null if
+	// nothing was published in time, in which case the front slot is left as it was.
+	T* Acquire(std::chrono::milliseconds timeout) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!changed.wait_for(lock, timeout, [this] { return fresh; })) {
+			return nullptr;
+		}
+		std::swap(front, ready);
+		fresh = false;
+		changed.notify_all();
+		return &slots[front];
+	}
+
+	// The slot last taken by the consumer
+	T& Front() {
+		return slots[front];
+	}
+
+private:
+	T slots[3];
+	int back = 0;
+	int ready = 1;
+	int front = 2;
+	bool fresh = false;	// Whether the ready slot holds a frame the consumer hasn't taken
+	std::mutex mutex;
+	std::condition_variable changed;
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include "ECSLib.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <vector>
+#include <future>
+#include <chrono>
+
+// WorldRunner Class:
+// Steps many independent games side by side on a thread pool, such as headless matches for bots
+// or server instances. A game is only ever stepped by one job at a time, so its scenes need no
+// locking, and each job stops early once its game has used up its time budget for the batch.
+class WorldRunner {
+public:
+	// Supporting struct for the throughput of one or more batches
+	struct Stats {
+		long long ticks = 0;	// Frames stepped, summed over the worlds
+		int running = 0;	// Worlds that haven't ended yet
+		int overBudget = 0;	// Worlds that stopped short of the requested ticks to stay in budget
+		double milliseconds = 0;	// Wall-clock time taken
+		double busyMilliseconds = 0;	// Time spent stepping, summed over the worlds
+
+		double TicksPerSecond() const {
+			return milliseconds > 0 ? ticks * 1000 / milliseconds : 0;
+		}
+		// Throughput of a single core, counting only the time spent stepping
+		double TicksPerCoreSecond() const {
+			return busyMilliseconds > 0 ? ticks * 1000 / busyMilliseconds : 0;
+		}
+	};
+
+	WorldRunner(int threads = std::thread::hardware_concurrency()) : pool(threads) {}
+
+	// Add a game to be started in the given scene. The game is set up by the first batch, on the pool.
+	void Add(std::shared_ptr<Game> game, std::string scene) {
+		worlds.push_back({ game, scene });
+	}
+
+	// Step every running world up to the given number of frames, in parallel. A world that takes
+	// longer than the budget (in milliseconds, 0 for none) stops early and carries on next batch.
+	Stats Run(int ticks, double budget = 0) {
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::future<void>> jobs;
+		for (auto& world : worlds) {
+			if (!world.ended) {
+				jobs.push_back(pool.Submit([&world, ticks, budget] { world.Run(ticks, budget); }));
+			}
+		}
+		for (auto& job : jobs) {
+			job.get();
+		}
+
+		Stats batch;
+		for (auto& world : worlds) {
+			batch.ticks += world.batchTicks;
+			batch.busyMilliseconds += world.batchMilliseconds;
+			batch.overBudget += world.overBudget ? 1 : 0;
+			batch.running += world.ended ? 0 : 1;
+			world.batchTicks = 0;
+			world.batchMilliseconds = 0;
+			world.overBudget = false;
+		}
+		batch.milliseconds = Profiler::Since(start);
+		total.ticks += batch.ticks;
+		total.busyMilliseconds += batch.busyMilliseconds;
+		total.overBudget += batch.overBudget;
+		total.running = batch.running;
+		total.milliseconds += batch.milliseconds;
+		return batch;
+	}
+
+	// Run batches until every world has ended
+	Stats RunAll(int ticksPerBatch = 60, double budget = 0) {
+		while (Run(ticksPerBatch, budget).running > 0) {}
+		return total;
+	}
+
+	// Totals over every batch run so far
+	Stats Total() {
+		return total;
+	}
+	int Size() {
+		return worlds.size();
+	}
+	int Threads() {
+		return pool.Size();
+	}
+
+private:
+	// Supporting struct for a game and its progress. Only the job stepping it touches it during a batch.
+	struct World {
+		std::shared_ptr<Game> game;
+		std::string scene;
+		bool started = false;
+		bool ended = false;
+		bool overBudget = false;
+		long long batchTicks = 0;
+		double batchMilliseconds = 0;
+
+		void Run(int ticks, double budget) {
+			auto start = std::chrono::steady_clock::now();
+			if (!started) {
+				game->Begin(scene);
+				started = true;
+			}
+			for (int i = 0; i < ticks && !ended; i++) {
+				ended = game->Step();
+				batchTicks++;
+				if (budget > 0 && i + 1 < ticks && Profiler::Since(start) >= budget) {
+					overBudget = !ended;
+					break;
+				}
+			}
+			batchMilliseconds = Profiler::Since(start);
+		}
+	};
+
+	std::vector<World> worlds;
+	Stats total;
+	ThreadPool pool;	// Declared last so that its jobs finish before the worlds are destroyed
+};